@@ -3,7 +3,28 @@
 #include <iostream>
 #include <fstream>
 #include <unordered_set>
+#include <unordered_map>
+#include <set>
+#include <map>
 #include <sstream>
+#include <string_view>
+#include <iterator>
+#include <chrono>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <system_error>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 
 #if 1
 	#include <filesystem>
@@ -14,20 +35,89 @@
 	namespace fs = ghc::filesystem;
 #endif
 
+// Native directory listing backend, selected at runtime with --backend.
+#if defined(__linux__)
+	#define VISUALGEN_NATIVE_SCAN
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+#endif
+
+// Watch mode, regenerating projects from inotify events.
+#if defined(__linux__)
+	#define VISUALGEN_WATCH
+	#include <poll.h>
+	#include <sys/inotify.h>
+#endif
+
+// Memory-mapped reading of indices and projects.
+#if !defined(_WIN32)
+	#define VISUALGEN_MMAP
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+// Batched file status requests through io_uring.
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#define VISUALGEN_IO_URING
+		#include <cerrno>
+		#include <unistd.h>
+		#include <sys/mman.h>
+		#include <sys/stat.h>
+		#include <sys/syscall.h>
+		#include <linux/io_uring.h>
+	#endif
+#endif
+
+// Peak memory reporting.
+// Process identifier, naming temporary files.
+#if defined(_WIN32)
+	#include <process.h>
+#else
+	#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+	#define VISUALGEN_RUSAGE
+	#include <sys/resource.h>
+#endif
+
 // --------------------------------------------------------------------------------
 // Simon Rodriguez, June 2025
 // --------------------------------------------------------------------------------
 // TODO:
-// * update a vcxproj/vcxproj.filters in place by removing all ItemGroups that contain ClCompile/ClInclude/FXCompile/Text/None items.
-// 	 That way we won't have to handle the SLN generation nor the UUID update, and can remove the header/footer arguments.
+// * update the vcxproj.filters in place too: --in-place only merges the items of the vcxproj,
+// 	 the filters are still regenerated from the scan and lose their manual edits.
 // --------------------------------------------------------------------------------
 
-const std::string helpStr = "visualgen path/to/vcxproj local/path/to/dir \"cpp,c\" \"h,hpp\" \"excluded,paths\"";
+const std::string helpStr = "visualgen [-j N] [--backend=native|std] [--full] [--in-place] [--check|--verify] [--gitignore] [--no-prune] [--ignore-extension-case] [--source=disk|git-index|list[:path]] [--watch|--stream|--memory-budget=N[K|M|G]] path/to/vcxproj local/path/to/dir \"cpp,c\" \"h,hpp\" \"excluded,paths\"\n"
+	"visualgen [-j N] [--backend=native|std] [--full] [--in-place] [--check|--verify] [--gitignore] [--no-prune] [--ignore-extension-case] [--source=disk|git-index|list[:path]] --batch path/to/manifest\n"
+	"--in-place merges the items of the existing .vcxproj only, the .vcxproj.filters is regenerated.";
 
 // --------------------------------------------------------------------------------
 //	String and path utilities
 // --------------------------------------------------------------------------------
 
+// Order of fs::path for relative paths without redundant separators: a byte-wise comparison
+// where the separator comes before any other character.
+bool lessPath(std::string_view pathA, std::string_view pathB){
+	const size_t size = std::min(pathA.size(), pathB.size());
+	for(size_t i = 0; i < size; ++i){
+		if(pathA[i] != pathB[i]){
+			if(pathA[i] == (char)fs::path::preferred_separator || pathB[i] == (char)fs::path::preferred_separator){
+				return pathA[i] == (char)fs::path::preferred_separator;
+			}
+			return (unsigned char)pathA[i] < (unsigned char)pathB[i];
+		}
+	}
+	return pathA.size() < pathB.size();
+}
+
 void replace(std::string & source, const std::string & fromString, const std::string & toString) {
 	std::string::size_type nextPos = 0;
 	const size_t fromSize		   = fromString.size();
@@ -92,7 +182,10 @@ std::unordered_set<std::string> extractExtensions(const std::string& extensionLi
 }
 
 
-void collectDirectoriesAlongPath(const fs::path& path, std::unordered_set<std::string>& directories){
+// Call the visitor with the filter of each parent directory of a path, from the deepest
+// one up, until it returns false.
+template<typename Visitor>
+void visitDirectoriesAlongPath(const fs::path& path, Visitor&& visitor){
 	fs::path currentPath = path;
 	// Stop when we reach the root, its own parent.
 	while(currentPath.has_parent_path() && (currentPath.root_directory() != currentPath)){
@@ -101,9 +194,7 @@ void collectDirectoriesAlongPath(const fs::path& path, std::unordered_set<std::s
 		replace(pathStr, "/", "\\");
 		// Skip root or empty.
 		if(!pathStr.empty() && (pathStr != "\\") ){
-			auto res = directories.insert(pathStr);
-			// If the directory was already encountered, skip.
-			if(!res.second){
+			if(!visitor(pathStr)){
 				break;
 			}
 		}
@@ -111,250 +202,5723 @@ void collectDirectoriesAlongPath(const fs::path& path, std::unordered_set<std::s
 }
 
 // --------------------------------------------------------------------------------
-//	Go go go
+//	Work-stealing task pool
 // --------------------------------------------------------------------------------
 
-int main(int argc, char** argv){
+// Each worker owns a queue: it pops its own most recent task first (depth first),
+// and when empty steals the oldest task of another worker (largest remaining work).
+class TaskPool {
+public:
+	// A task receives the index of the worker executing it.
+	using Task = std::function<void(unsigned int)>;
 
-	if(argc < 3 || argc > 6){
-		std::cout << helpStr << std::endl;
-		return 0;
+	explicit TaskPool(unsigned int workerCount) : queues(std::max(workerCount, 1u)) {}
+
+	unsigned int workerCount() const {
+		return (unsigned int)queues.size();
 	}
 
-	// Parameters
-	const fs::path projectPath = fs::path(argv[ 1 ]);
-	const fs::path inputDirPath = fs::path(argv[ 2 ]);
-	
-	const std::string compileExtensionsList = argc > 3 ? argv[3] : "";
-	const std::string includeExtensionsList = argc > 4 ? argv[4] : "";
-	const std::string excludedDirs = argc > 5 ? argv[5] : "";
+	// Queue a task on the given worker, can be called from a running task.
+	void push(Task&& task, unsigned int workerId){
+		++pendingCount;
+		Queue& queue = queues[workerId % queues.size()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.emplace_back(std::move(task));
+		}
+		{
+			std::lock_guard<std::mutex> lock(idleMutex);
+			++queuedCount;
+		}
+		idleCondition.notify_one();
+	}
+
+	// Execute all queued tasks and the ones they spawn, the calling thread is worker 0.
+	void run(){
+		std::vector<std::thread> threads;
+		for(unsigned int i = 1; i < workerCount(); ++i){
+			threads.emplace_back(&TaskPool::workerLoop, this, i);
+		}
+		workerLoop(0);
+		for(std::thread& thread : threads){
+			thread.join();
+		}
+	}
 
-	const std::string projectName = projectPath.stem().string();
-	fs::path outputVcxprojPath = projectPath;
-	fs::path outputFilterPath = outputVcxprojPath;
-	outputVcxprojPath.replace_extension(".vcxproj");
-	outputFilterPath.replace_extension(".vcxproj.filters");
+private:
 
-	const std::unordered_set<std::string> compileExtensions = extractExtensions(compileExtensionsList);
-	const std::unordered_set<std::string> includeExtensions = extractExtensions(includeExtensionsList);
-	const bool noExtensionFilter = compileExtensions.empty() && includeExtensions.empty();
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
 
-	const std::unordered_set<std::string> excludedRootDirs = extractItems( excludedDirs );
+	bool pop(unsigned int workerId, Task& task){
+		Queue& queue = queues[workerId];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(queue.tasks.empty()){
+			return false;
+		}
+		task = std::move(queue.tasks.back());
+		queue.tasks.pop_back();
+		--queuedCount;
+		return true;
+	}
+
+	bool steal(unsigned int workerId, Task& task){
+		const size_t count = queues.size();
+		for(size_t i = 1; i < count; ++i){
+			Queue& queue = queues[(workerId + i) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(queue.tasks.empty()){
+				continue;
+			}
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			--queuedCount;
+			return true;
+		}
+		return false;
+	}
+
+	void workerLoop(unsigned int workerId){
+		Task task;
+		while(true){
+			if(pop(workerId, task) || steal(workerId, task)){
+				task(workerId);
+				task = nullptr;
+				if(--pendingCount == 0){
+					std::lock_guard<std::mutex> lock(idleMutex);
+					idleCondition.notify_all();
+				}
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(idleMutex);
+			idleCondition.wait(lock, [this](){ return pendingCount == 0 || queuedCount > 0; });
+			if(pendingCount == 0){
+				return;
+			}
+		}
+	}
+
+	std::vector<Queue> queues;
+	// Tasks queued or running, and tasks queued only.
+	std::atomic<size_t> pendingCount{0};
+	std::atomic<size_t> queuedCount{0};
+	std::mutex idleMutex;
+	std::condition_variable idleCondition;
+};
+
+// --------------------------------------------------------------------------------
+//	Memory-mapped files
+// --------------------------------------------------------------------------------
 
-	std::cout << "Processing " << inputDirPath.string() << " to " << outputVcxprojPath.string() << std::endl;
+// Read-only view of a whole file, mapped when the platform allows it.
+#ifdef VISUALGEN_MMAP
+// Advisory lock on a whole file, released when any descriptor of the file is closed by the process.
+bool lockFile(int fd, short type, bool wait){
+	struct flock lock = {};
+	lock.l_type = type;
+	lock.l_whence = SEEK_SET;
+	int result;
+	do {
+		result = fcntl(fd, wait ? F_SETLKW : F_SETLK, &lock);
+	} while(result != 0 && errno == EINTR);
+	return result == 0;
+}
+#endif
 
-	// Collect file paths and directories
-	std::vector<fs::path> compileFilePaths;
-	std::vector<fs::path> includeFilePaths;
-	std::unordered_set<std::string> directoryPaths;
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
 
-	fs::recursive_directory_iterator filesIterator( inputDirPath );
-	for(const auto& entry : filesIterator ){
+	~MappedFile(){
+		release();
+	}
 
-		const fs::path entryPath = relative( entry.path(), inputDirPath );
-		if(!entry.is_regular_file()){
-			// Skip directory if it is among the excluded sub-root directories.
-			if( excludedRootDirs.count( entryPath.string() ) != 0 ){
-				filesIterator.disable_recursion_pending();
+	// With a shared lock, the file is kept open and locked until released,
+	// for writers that overwrite it in place to wait until it isn't mapped anymore.
+	bool open(const fs::path& path, bool sharedLock = false){
+		release();
+#ifdef VISUALGEN_MMAP
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0){
+			return false;
+		}
+		if(sharedLock){
+			if(!lockFile(fd, F_RDLCK, true)){
+				::close(fd);
+				return false;
 			}
-			continue;
+			lockedFd = fd;
 		}
-		const fs::path filename = entryPath.filename();
-		const std::string entryName = filename.string();
-		// Skip hidden
-		if(entryName.empty() || entryName[0] == '.'){
-			continue;
+		struct stat status;
+		if(fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)){
+			closeUnlocked(fd);
+			return false;
 		}
-		// Skip generated files.
-		if(filename == outputVcxprojPath.filename() || filename == outputFilterPath.filename()){
-			continue;
+		if(status.st_size != 0){
+			void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapping == MAP_FAILED){
+				closeUnlocked(fd);
+				return false;
+			}
+			fileData = static_cast<const char*>(mapping);
+			fileSize = (size_t)status.st_size;
+		}
+		closeUnlocked(fd);
+		return true;
+#else
+		(void)sharedLock;
+		std::ifstream file(path, std::ios::binary);
+		if(!file.is_open()){
+			return false;
+		}
+		fallbackData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		fileData = fallbackData.data();
+		fileSize = fallbackData.size();
+		return true;
+#endif
+	}
+
+	const char* data() const {
+		return fileData;
+	}
+
+	size_t size() const {
+		return fileSize;
+	}
+
+private:
+
+	void release(){
+#ifdef VISUALGEN_MMAP
+		if(fileData != nullptr){
+			munmap(const_cast<char*>(fileData), fileSize);
 		}
-		// If no filter, assume everything is compiled.
-		if(noExtensionFilter || (compileExtensions.count(filename.extension().string()) != 0)){
-			compileFilePaths.emplace_back(entryPath);
-			collectDirectoriesAlongPath(entryPath, directoryPaths);
+		if(lockedFd >= 0){
+			::close(lockedFd);
+			lockedFd = -1;
 		}
-		if(includeExtensions.count(filename.extension().string()) != 0){
-			includeFilePaths.emplace_back(entryPath);
-			collectDirectoriesAlongPath(entryPath, directoryPaths);
+#endif
+		fallbackData.clear();
+		fileData = nullptr;
+		fileSize = 0;
+	}
+
+#ifdef VISUALGEN_MMAP
+	// The locked descriptor is closed on release.
+	void closeUnlocked(int fd){
+		if(fd != lockedFd){
+			::close(fd);
 		}
 	}
 
-	// Sort filters from smallest to largest, that way a parent is always before its children.
-	std::vector<std::string> filterPaths;
-	filterPaths.insert(filterPaths.begin(), directoryPaths.begin(), directoryPaths.end());
-	std::sort(filterPaths.begin(), filterPaths.end());
-	std::sort(compileFilePaths.begin(), compileFilePaths.end());
-	std::sort(includeFilePaths.begin(), includeFilePaths.end());
+	int lockedFd = -1;
+#endif
+	const char* fileData = nullptr;
+	size_t fileSize = 0;
+	std::vector<char> fallbackData;
+};
 
+// --------------------------------------------------------------------------------
+//	Batched file status
+// --------------------------------------------------------------------------------
 
-	std::string vcxprojHeader; 
-	vcxprojHeader.append( "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" );
-	vcxprojHeader.append( "<Project DefaultTargets=\"Build\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n\n" );
+// Requests in flight in a status queue.
+constexpr unsigned int statQueueDepth = 256;
 
-	std::string vcxprojFooter;
-	vcxprojFooter.append( "\n<PropertyGroup Label=\"Globals\">\n" );
-	vcxprojFooter.append( "\t<RootNamespace>" + projectName + "</RootNamespace>\n" );
-	vcxprojFooter.append( "</PropertyGroup>\n\n" );
-	vcxprojFooter.append( "</Project>\n" );
+#ifdef VISUALGEN_IO_URING
 
-	// Open existing .vcxproj
-	{
-		std::ifstream vcxprojRef( projectPath );
-		if( vcxprojRef.is_open() )
-		{
-			std::string fullContent;
-			std::string line;
-			while( std::getline( vcxprojRef, line ) )
-			{
-				fullContent.append( line );
-				fullContent.append( "\n" );
-			}
-			vcxprojRef.close();
-
-			const std::string startToken = "<ItemGroup>";
-			const std::string endToken = "</ItemGroup>";
-			std::vector<std::pair<size_t, size_t>> groupRanges;
-			std::string::size_type currentPos = 0;
-			while( currentPos < fullContent.size() )
-			{
-				std::string::size_type nextGroupStart = fullContent.find( startToken, currentPos );
-				if( nextGroupStart == std::string::npos )
-					break;
-				std::string::size_type nextGroupEnd = fullContent.find( endToken, nextGroupStart );
-				if( nextGroupEnd == std::string::npos )
-					break;
-
-				currentPos = nextGroupEnd + endToken.size();
-				groupRanges.emplace_back( ( size_t)nextGroupStart, ( size_t )currentPos);
-			}
-			// If no group found, artificially insert one just before the end
-			if( groupRanges.empty() )
-			{
-				std::string::size_type projectEnd = fullContent.find( "</Project>");
-				if( (projectEnd != std::string::npos) && (projectEnd > 0))
-				{
-					groupRanges.emplace_back( ( size_t)(projectEnd), ( size_t)projectEnd );
-				}
-			}
-			
-			if( !groupRanges.empty() )
-			{
-				vcxprojHeader = fullContent.substr( 0, groupRanges[ 0 ].first );
-				vcxprojFooter = "";
-				unsigned int i = 1;
-				for(; i < groupRanges.size(); ++i )
-				{
-					const size_t prevEnd = groupRanges[ i - 1 ].second;
-					const size_t nextStart = groupRanges[ i  ].first;
-					const size_t gapSize = nextStart - prevEnd;
-					std::string gapStr = fullContent.substr( prevEnd, gapSize );
-					// Skip empty lines.
-					if( gapStr.empty() || (gapStr.find_first_not_of( "\n\r \t" ) == std::string::npos) )
-						continue;
-					vcxprojFooter.append( gapStr );
-				}
-				vcxprojFooter.append( fullContent.substr( groupRanges[ i - 1 ].second ) );
-			}
-			else
-			{
-				// If groups still empty, probably malformed, attempt to save face.
-				vcxprojHeader = fullContent;
-				vcxprojFooter = "\n</Project>";
-			}
-		}
-
-	}
-	// Generate .vcxproj
-	{
-		std::ofstream vcxproj(outputVcxprojPath);
-		if(!vcxproj.is_open()){
-			std::cout << "Error" << std::endl;
-			return 1;
+// Queue of statx requests submitted by batches to an io_uring, completed asynchronously
+// by the kernel. Each completion gives the tag of its request, its error number or zero and
+// the file mode. Paths must stay valid until their completion has been delivered.
+class StatQueue {
+public:
+
+	StatQueue() = default;
+	StatQueue(const StatQueue&) = delete;
+	StatQueue& operator=(const StatQueue&) = delete;
+
+	~StatQueue(){
+		// The kernel still writes to the slots of requests in flight.
+		auto ignore = [](uint64_t, int, uint32_t){};
+		if(ringFd >= 0){
+			drain(ignore);
+		}
+		release();
+	}
+
+	// Fails if io_uring is unavailable, denied or without statx, callers then stat synchronously.
+	bool open(unsigned int entries){
+		release();
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		ringFd = (int)syscall(SYS_io_uring_setup, entries, &params);
+		if(ringFd < 0){
+			return false;
+		}
+		if(!supportsStatx()){
+			release();
+			return false;
+		}
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if(singleMapping){
+			sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+		}
+		sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+		cqRing = singleMapping ? sqRing : mapRing(cqRingSize, IORING_OFF_CQ_RING);
+		sqeCount = params.sq_entries;
+		void* sqeMapping = mmap(nullptr, sqeCount * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+		sqes = sqeMapping == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqeMapping);
+		if(sqRing == nullptr || cqRing == nullptr || sqes == nullptr){
+			release();
+			return false;
+		}
+		sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+		sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+		cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+		cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+		// At most one request in flight per submission entry, the completion ring being larger.
+		slots.resize(sqeCount);
+		freeSlots.resize(sqeCount);
+		for(unsigned int i = 0; i < sqeCount; ++i){
+			freeSlots[i] = sqeCount - 1 - i;
+		}
+		return true;
+	}
+
+	// Queue the status request of a path relative to a directory descriptor, with statx flags.
+	// Completions are delivered while waiting for a free slot.
+	template<typename Completion>
+	bool push(int dirFd, const char* path, int flags, uint64_t tag, Completion& onComplete){
+		while(freeSlots.empty()){
+			if(!wait(1, onComplete)){
+				return false;
+			}
+		}
+		const unsigned int slot = freeSlots.back();
+		freeSlots.pop_back();
+		slots[slot].tag = tag;
+
+		const unsigned int tail = *sqTail;
+		const unsigned int index = tail & sqMask;
+		io_uring_sqe& sqe = sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_STATX;
+		sqe.fd = dirFd;
+		sqe.addr = (uint64_t)(uintptr_t)path;
+		sqe.len = STATX_TYPE | STATX_MODE;
+		sqe.off = (uint64_t)(uintptr_t)&slots[slot].status;
+		sqe.statx_flags = (uint32_t)flags;
+		sqe.user_data = slot;
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		++unsubmittedCount;
+		++pendingCount;
+		// Submit by batches to amortize the system calls, a failed submission being retried when waiting.
+		if(unsubmittedCount >= submitBatchSize){
+			enter(0);
+		}
+		return true;
+	}
+
+	// Deliver the completions already available, submitting queued requests.
+	template<typename Completion>
+	bool poll(Completion& onComplete){
+		return wait(0, onComplete);
+	}
+
+	// Wait for all the queued requests.
+	template<typename Completion>
+	bool drain(Completion& onComplete){
+		while(pendingCount != 0){
+			if(!wait(1, onComplete)){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t pending() const {
+		return pendingCount;
+	}
+
+private:
+
+	struct Slot {
+		struct statx status;
+		uint64_t tag;
+	};
+
+	static constexpr unsigned int submitBatchSize = 64;
+
+	// Kernels before 5.6 create rings but fail statx requests, and can't be probed either.
+	bool supportsStatx() const {
+		constexpr unsigned int opCount = 256;
+		alignas(io_uring_probe) char buffer[sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op)];
+		std::memset(buffer, 0, sizeof(buffer));
+		io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer);
+		if(syscall(SYS_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, opCount) < 0){
+			return false;
 		}
+		return IORING_OP_STATX <= probe->last_op && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) != 0;
+	}
 
-		vcxproj << vcxprojHeader;
+	char* mapRing(size_t size, off_t offset){
+		void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+		return mapping == MAP_FAILED ? nullptr : static_cast<char*>(mapping);
+	}
 
-		if(!includeFilePaths.empty()){
-			vcxproj << "<ItemGroup>\n";
-			for(const fs::path& path : includeFilePaths){
-				vcxproj << "\t<ClInclude Include=\"" << path.string() << "\" />\n";
+	bool enter(unsigned int minComplete){
+		while(true){
+			const long result = syscall(SYS_io_uring_enter, ringFd, unsubmittedCount, minComplete, minComplete != 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+			if(result >= 0){
+				unsubmittedCount -= std::min(unsubmittedCount, (unsigned int)result);
+				return true;
 			}
-			vcxproj << "</ItemGroup>";
-			if( !compileFilePaths.empty() ){
-				vcxproj << "\n";
+			if(errno != EINTR && errno != EAGAIN && errno != EBUSY){
+				return false;
 			}
 		}
+	}
 
-		if(!compileFilePaths.empty()){
-			vcxproj << "<ItemGroup>\n";
-			for(const fs::path& path : compileFilePaths){
-				vcxproj << "\t<ClCompile Include=\"" << path.string() << "\" />\n";
+	template<typename Completion>
+	bool wait(unsigned int minComplete, Completion& onComplete){
+		if(unsubmittedCount != 0 || (minComplete != 0 && available() == 0)){
+			if(!enter(available() == 0 ? minComplete : 0)){
+				return false;
 			}
-			vcxproj << "</ItemGroup>";
 		}
+		unsigned int head = *cqHead;
+		const unsigned int tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		for(; head != tail; ++head){
+			const io_uring_cqe& cqe = cqes[head & cqMask];
+			const unsigned int slot = (unsigned int)cqe.user_data;
+			const Slot& request = slots[slot];
+			onComplete(request.tag, cqe.res < 0 ? -cqe.res : 0, (uint32_t)request.status.stx_mode);
+			freeSlots.push_back(slot);
+			--pendingCount;
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return true;
+	}
 
-		vcxproj << vcxprojFooter;
-		vcxproj.close();
+	unsigned int available() const {
+		return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead;
 	}
-	
 
-	// Generate .vcxproj.filters
-	{
-		std::ofstream filters(outputFilterPath);
-		if(!filters.is_open()){
-			std::cout << "Error" << std::endl;
-			return 1;
+	void release(){
+		if(sqes != nullptr){
+			munmap(sqes, sqeCount * sizeof(io_uring_sqe));
+		}
+		if(cqRing != nullptr && cqRing != sqRing){
+			munmap(cqRing, cqRingSize);
+		}
+		if(sqRing != nullptr){
+			munmap(sqRing, sqRingSize);
+		}
+		if(ringFd >= 0){
+			::close(ringFd);
+		}
+		ringFd = -1;
+		sqRing = cqRing = nullptr;
+		sqes = nullptr;
+		slots.clear();
+		freeSlots.clear();
+		unsubmittedCount = 0;
+		pendingCount = 0;
+	}
+
+	int ringFd = -1;
+	char* sqRing = nullptr;
+	char* cqRing = nullptr;
+	size_t sqRingSize = 0;
+	size_t cqRingSize = 0;
+	io_uring_sqe* sqes = nullptr;
+	unsigned int sqeCount = 0;
+	unsigned* sqTail = nullptr;
+	unsigned sqMask = 0;
+	unsigned* sqArray = nullptr;
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	unsigned cqMask = 0;
+	io_uring_cqe* cqes = nullptr;
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+	unsigned int unsubmittedCount = 0;
+	size_t pendingCount = 0;
+};
+
+// Errors telling that a path doesn't exist, others leaving its status unknown.
+bool isMissingPathError(int error){
+	return error == ENOENT || error == ENOTDIR;
+}
+
+#endif
+
+// Whether each path, relative to a directory, exists and isn't a directory. Requests go
+// through io_uring when available, otherwise chunks of paths are checked in parallel.
+// Paths must be null-terminated.
+void statFiles(const fs::path& dirPath, const std::vector<std::string_view>& paths, std::vector<unsigned char>& isFile, unsigned int workerCount){
+	isFile.assign(paths.size(), 0);
+#ifdef VISUALGEN_IO_URING
+	const int dirFd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(dirFd >= 0){
+		StatQueue queue;
+		bool success = queue.open(statQueueDepth);
+		// Requests failing otherwise than on a missing path are checked again synchronously.
+		std::vector<size_t> unknownPaths;
+		auto onComplete = [&isFile, &unknownPaths](uint64_t tag, int error, uint32_t mode){
+			if(error == 0){
+				isFile[tag] = !S_ISDIR(mode);
+			} else if(!isMissingPathError(error)){
+				unknownPaths.push_back((size_t)tag);
+			}
+		};
+		for(size_t i = 0; i < paths.size() && success; ++i){
+			success = queue.push(dirFd, paths[i].data(), 0, i, onComplete);
+		}
+		success = success && queue.drain(onComplete);
+		for(const size_t i : unknownPaths){
+			struct stat status;
+			isFile[i] = fstatat(dirFd, paths[i].data(), &status, 0) == 0 && !S_ISDIR(status.st_mode);
 		}
+		::close(dirFd);
+		if(success){
+			return;
+		}
+	}
+#endif
+	constexpr size_t chunkSize = 256;
+	TaskPool pool(workerCount);
+	for(size_t begin = 0; begin < paths.size(); begin += chunkSize){
+		const size_t end = std::min(paths.size(), begin + chunkSize);
+		pool.push([&dirPath, &paths, &isFile, begin, end](unsigned int){
+			for(size_t i = begin; i < end; ++i){
+				std::error_code error;
+				const fs::file_status status = fs::status(dirPath / fs::path(paths[i]), error);
+				isFile[i] = fs::exists(status) && !fs::is_directory(status);
+			}
+		}, 0);
+	}
+	pool.run();
+}
+
+// --------------------------------------------------------------------------------
+//	Scan index
+// --------------------------------------------------------------------------------
+// Persisted next to the project, the index stores for each scanned directory its
+// modification time, its non-excluded subdirectories and its classified files.
+// On the next run, directories whose modification time is unchanged are not listed.
+// Layout: header { "VGIX", version u32, settings hash u64, directory count u64 }
+// followed by one record per directory:
+// { path, time i64, subdir count u32, { name }, file count u32, { compile mask, include mask, name } }
+// where strings are stored as a u32 size followed by the characters, and project masks as varints.
+
+enum FileKind : unsigned char {
+	FILE_COMPILE = 1 << 0,
+	FILE_INCLUDE = 1 << 1,
+};
+
+// One bit per project sharing a scan.
+using ProjectMask = uint64_t;
+
+const char scanIndexMagic[4] = { 'V', 'G', 'I', 'X' };
+const uint32_t scanIndexVersion = 3;
+// Directories modified that close to a scan could have changed within the timestamp granularity.
+const int64_t racyTimeWindow = 2000000000ll;
+const int64_t unknownTime = std::numeric_limits<int64_t>::min();
+
+uint64_t hashString(const std::string& str){
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for(const char c : str){
+		hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Times are expressed in nanoseconds, in the clock used by the filesystem backend.
+template<typename Duration>
+int64_t toNanoseconds(const Duration& duration){
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+struct IndexReader {
+	const char* current = nullptr;
+	const char* end = nullptr;
+
+	template<typename T>
+	bool read(T& value){
+		if((size_t)(end - current) < sizeof(T)){
+			return false;
+		}
+		std::memcpy(&value, current, sizeof(T));
+		current += sizeof(T);
+		return true;
+	}
 
-		filters << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
-		filters << "<Project ToolsVersion=\"4.0\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n";
-		filters << "\n";
+	bool readString(std::string_view& str){
+		uint32_t size = 0;
+		if(!read(size) || (size_t)(end - current) < size){
+			return false;
+		}
+		str = std::string_view(current, size);
+		current += size;
+		return true;
+	}
 
-		if(!directoryPaths.empty()){
-			filters << "<ItemGroup>\n";
-			for(const std::string& filter : filterPaths){
-				filters << "\t<Filter Include=\"" << filter << "\">\n";
-        		// optional: filters << "\t	<UniqueIdentifier>" << "0" << "</UniqueIdentifier>\n";
-        		filters << "\t</Filter>\n";
+	bool readVarint(uint64_t& value){
+		value = 0;
+		for(unsigned int shift = 0; shift < 64; shift += 7){
+			if(current == end){
+				return false;
+			}
+			const unsigned char byte = (unsigned char)*(current++);
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if((byte & 0x80) == 0){
+				return true;
 			}
-			filters << "</ItemGroup>\n";
-			filters << "\n";
 		}
+		return false;
+	}
+};
+
+struct IndexWriter {
+	std::string data;
+
+	template<typename T>
+	void write(const T& value){
+		data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void writeString(std::string_view str){
+		write((uint32_t)str.size());
+		data.append(str);
+	}
+
+	void writeVarint(uint64_t value){
+		while(value >= 0x80){
+			data.push_back((char)((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		data.push_back((char)value);
+	}
+};
+
+// Names are owned by the scan results.
+struct IndexFileRecord {
+	ProjectMask compileMask;
+	ProjectMask includeMask;
+	std::string_view name;
+};
+
+struct IndexDirectoryRecord {
+	std::string relativePath;
+	int64_t modificationTime = unknownTime;
+	std::vector<std::string_view> subdirectories;
+	std::vector<IndexFileRecord> files;
+	// Unchanged directories are copied as is from the previous index.
+	std::string_view previousRecord;
+
+	std::string_view path() const {
+		if(previousRecord.empty()){
+			return relativePath;
+		}
+		IndexReader reader;
+		reader.current = previousRecord.data();
+		reader.end = previousRecord.data() + previousRecord.size();
+		std::string_view recordPath;
+		reader.readString(recordPath);
+		return recordPath;
+	}
+};
 
-		if(!includeFilePaths.empty()){
-			filters << "<ItemGroup>\n";
-			for(const fs::path& path : includeFilePaths){
-				std::string filter = path.parent_path().string();
-				replace(filter, "/", "\\");
+class ScanIndex {
+public:
 
-				filters << "\t<ClInclude Include=\"" << path.string() << "\">\n";
-				filters << "\t\t<Filter>" << filter << "</Filter>\n";
-				filters << "\t</ClInclude>\n";
+	bool load(const fs::path& path, uint64_t settingsHash){
+		if(!file.open(path, true)){
+			return false;
+		}
+		IndexReader reader;
+		reader.current = file.data();
+		reader.end = file.data() + file.size();
+		char magic[4];
+		uint32_t version = 0;
+		uint64_t hash = 0;
+		uint64_t count = 0;
+		if(!reader.read(magic) || std::memcmp(magic, scanIndexMagic, 4) != 0 || !reader.read(version) || version != scanIndexVersion){
+			return false;
+		}
+		// Index produced with other settings, file lists can't be reused.
+		if(!reader.read(hash) || hash != settingsHash || !reader.read(count)){
+			return false;
+		}
+		directories.reserve((size_t)count);
+		for(uint64_t i = 0; i < count; ++i){
+			const char* recordStart = reader.current;
+			std::string_view relativePath;
+			if(!reader.readString(relativePath) || !skipRecord(reader)){
+				directories.clear();
+				return false;
 			}
-			filters << "</ItemGroup>\n";
-			filters << "\n";
+			directories[relativePath] = std::string_view(recordStart, reader.current - recordStart);
+		}
+		return true;
+	}
+
+	size_t directoryCount() const {
+		return directories.size();
+	}
+
+	// Find the record of a directory that hasn't been modified since the previous scan.
+	bool find(const std::string& relativePath, int64_t modificationTime, std::string_view& record, IndexReader& reader) const {
+		auto it = directories.find(relativePath);
+		if(it == directories.end()){
+			return false;
 		}
+		record = it->second;
+		reader.current = record.data();
+		reader.end = record.data() + record.size();
+		std::string_view path;
+		int64_t time = unknownTime;
+		reader.readString(path);
+		reader.read(time);
+		return time != unknownTime && time == modificationTime;
+	}
 
-		if(!compileFilePaths.empty()){
-			filters << "<ItemGroup>\n";
-			for(const fs::path& path : compileFilePaths){
-				std::string filter = path.parent_path().string();
-				replace(filter, "/", "\\");
+private:
 
-				filters << "\t<ClCompile Include=\"" << path.string() << "\">\n";
-				filters << "\t\t<Filter>" << filter << "</Filter>\n";
-				filters << "\t</ClCompile>\n";
+	static bool skipRecord(IndexReader& reader){
+		int64_t time;
+		uint32_t count;
+		std::string_view name;
+		if(!reader.read(time) || !reader.read(count)){
+			return false;
+		}
+		for(uint32_t i = 0; i < count; ++i){
+			if(!reader.readString(name)){
+				return false;
 			}
-			filters << "</ItemGroup>\n";
-			filters << "\n";
 		}
+		if(!reader.read(count)){
+			return false;
+		}
+		ProjectMask mask;
+		for(uint32_t i = 0; i < count; ++i){
+			if(!reader.readVarint(mask) || !reader.readVarint(mask) || !reader.readString(name)){
+				return false;
+			}
+		}
+		return true;
+	}
 
-		filters << "</Project>\n";
+	MappedFile file;
+	std::unordered_map<std::string_view, std::string_view> directories;
+};
 
-		filters.close();
+bool writeScanIndex(const fs::path& path, uint64_t settingsHash, const std::vector<IndexDirectoryRecord>& records){
+	IndexWriter writer;
+	writer.data.append(scanIndexMagic, 4);
+	writer.write(scanIndexVersion);
+	writer.write(settingsHash);
+	writer.write((uint64_t)records.size());
+	for(const IndexDirectoryRecord& record : records){
+		if(!record.previousRecord.empty()){
+			writer.data.append(record.previousRecord);
+			continue;
+		}
+		writer.writeString(record.relativePath);
+		writer.write(record.modificationTime);
+		writer.write((uint32_t)record.subdirectories.size());
+		for(const std::string_view& subdirectory : record.subdirectories){
+			writer.writeString(subdirectory);
+		}
+		writer.write((uint32_t)record.files.size());
+		for(const IndexFileRecord& file : record.files){
+			writer.writeVarint(file.compileMask);
+			writer.writeVarint(file.includeMask);
+			writer.writeString(file.name);
+		}
 	}
 
-	return 0;
+	// Overwrite in place: replacing the file would modify its parent directory, which is often
+	// scanned, invalidating it at each run. A truncated index is rejected when loaded.
+#ifdef VISUALGEN_MMAP
+	// Other runs map the index under a shared lock: it is left as is while one of them reads it,
+	// instead of being truncated under their mapping.
+	const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+	if(fd < 0){
+		return false;
+	}
+	bool success = lockFile(fd, F_WRLCK, false) && ftruncate(fd, 0) == 0;
+	for(size_t offset = 0; success && offset < writer.data.size();){
+		const ssize_t written = ::write(fd, writer.data.data() + offset, writer.data.size() - offset);
+		if(written < 0 && errno == EINTR){
+			continue;
+		}
+		success = written > 0;
+		offset += success ? (size_t)written : 0;
+	}
+	::close(fd);
+	return success;
+#else
+	std::ofstream indexFile(path, std::ios::binary | std::ios::trunc);
+	if(!indexFile.is_open()){
+		return false;
+	}
+	indexFile.write(writer.data.data(), writer.data.size());
+	return indexFile.good();
+#endif
+}
+
+// --------------------------------------------------------------------------------
+//	String arena
+// --------------------------------------------------------------------------------
+// Strings of a scan are copied in large blocks instead of being allocated one by one.
+// Views stay valid until the arena is destroyed, even when arenas are merged,
+// and everything is released at once.
+
+class StringArena {
+public:
+
+	// Reserve space for a string of the given size, filled by the caller.
+	char* allocate(size_t size){
+		if(size > remaining){
+			const size_t blockSize = std::max(size, minBlockSize);
+			blocks.emplace_back(new char[blockSize]);
+			current = blocks.back().get();
+			remaining = blockSize;
+		}
+		char* str = current;
+		current += size;
+		remaining -= size;
+		return str;
+	}
+
+	// Copies are null-terminated, to be usable as C strings. Empty views can have a null
+	// data pointer, never passed to memcpy.
+	std::string_view append(std::string_view str){
+		char* data = allocate(str.size() + 1);
+		if(!str.empty()){
+			std::memcpy(data, str.data(), str.size());
+		}
+		data[str.size()] = '\0';
+		return std::string_view(data, str.size());
+	}
+
+	// Concatenate strings, separated by a character if the first one is not empty.
+	std::string_view append(std::string_view head, char separator, std::string_view tail){
+		if(head.empty()){
+			return append(tail);
+		}
+		const size_t size = head.size() + 1 + tail.size();
+		char* data = allocate(size + 1);
+		std::memcpy(data, head.data(), head.size());
+		data[head.size()] = separator;
+		if(!tail.empty()){
+			std::memcpy(data + head.size() + 1, tail.data(), tail.size());
+		}
+		data[size] = '\0';
+		return std::string_view(data, size);
+	}
+
+	// Take ownership of the other arena blocks, its views remain valid.
+	void merge(StringArena& other){
+		blocks.insert(blocks.end(), std::make_move_iterator(other.blocks.begin()), std::make_move_iterator(other.blocks.end()));
+		other.blocks.clear();
+		other.current = nullptr;
+		other.remaining = 0;
+	}
+
+private:
+
+	static constexpr size_t minBlockSize = 256 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char* current = nullptr;
+	size_t remaining = 0;
+};
+
+// --------------------------------------------------------------------------------
+//	Path sorting
+// --------------------------------------------------------------------------------
+// Most significant byte first radix sort of strings. The order is byte-wise on unsigned
+// characters, independent of the locale, a string coming before its extensions. With
+// the separator first, it is the order of lessPath, and of fs::path for our relative paths.
+// Paths share long prefixes: bytes common to a whole bucket are skipped without moving items.
+
+const size_t radixBucketCount = 258;
+const size_t radixInsertionThreshold = 32;
+const size_t parallelSortThreshold = 1 << 16;
+
+// Bucket of the character at a given depth: 0 past the end, 1 for a separator sorted first.
+template<bool SeparatorFirst>
+unsigned int radixKey(std::string_view str, size_t depth){
+	if(depth >= str.size()){
+		return 0;
+	}
+	const unsigned char c = (unsigned char)str[depth];
+	if(SeparatorFirst && c == (unsigned char)fs::path::preferred_separator){
+		return 1;
+	}
+	return (unsigned int)c + 2;
+}
+
+// Compare strings sharing their first depth characters.
+template<bool SeparatorFirst>
+bool lessFrom(std::string_view strA, std::string_view strB, size_t depth){
+	if(SeparatorFirst){
+		return lessPath(strA.substr(depth), strB.substr(depth));
+	}
+	return strA.substr(depth) < strB.substr(depth);
+}
 
-}
\ No newline at end of file
+template<bool SeparatorFirst, typename T, typename GetString>
+void insertionSortFrom(T* items, size_t count, size_t depth, const GetString& getString){
+	for(size_t i = 1; i < count; ++i){
+		T item = std::move(items[i]);
+		size_t j = i;
+		for(; j > 0 && lessFrom<SeparatorFirst>(getString(item), getString(items[j - 1]), depth); --j){
+			items[j] = std::move(items[j - 1]);
+		}
+		items[j] = std::move(item);
+	}
+}
+
+// Distribute items in buckets on the first character where they differ, starting at the given depth
+// which is updated. Bucket bounds are stored in offsets. Returns false if all strings are equal.
+template<bool SeparatorFirst, typename T, typename GetString>
+bool partitionByCharacter(T* items, T* buffer, uint16_t* keys, size_t count, size_t& depth, size_t (&offsets)[radixBucketCount + 1], const GetString& getString){
+	while(true){
+		size_t counts[radixBucketCount] = {};
+		for(size_t i = 0; i < count; ++i){
+			keys[i] = (uint16_t)radixKey<SeparatorFirst>(getString(items[i]), depth);
+			++counts[keys[i]];
+		}
+		const unsigned int firstKey = keys[0];
+		if(counts[firstKey] == count){
+			if(firstKey == 0){
+				return false;
+			}
+			++depth;
+			continue;
+		}
+		size_t next[radixBucketCount];
+		offsets[0] = 0;
+		for(size_t bucket = 0; bucket < radixBucketCount; ++bucket){
+			next[bucket] = offsets[bucket];
+			offsets[bucket + 1] = offsets[bucket] + counts[bucket];
+		}
+		for(size_t i = 0; i < count; ++i){
+			buffer[next[keys[i]]++] = std::move(items[i]);
+		}
+		std::move(buffer, buffer + count, items);
+		return true;
+	}
+}
+
+template<bool SeparatorFirst, typename T, typename GetString>
+void radixSortFrom(T* items, T* buffer, uint16_t* keys, size_t count, size_t depth, const GetString& getString){
+	if(count < radixInsertionThreshold){
+		insertionSortFrom<SeparatorFirst>(items, count, depth, getString);
+		return;
+	}
+	size_t offsets[radixBucketCount + 1];
+	if(!partitionByCharacter<SeparatorFirst>(items, buffer, keys, count, depth, offsets, getString)){
+		return;
+	}
+	// Strings ending at this depth are all equal, skip their bucket.
+	for(size_t bucket = 1; bucket < radixBucketCount; ++bucket){
+		const size_t bucketSize = offsets[bucket + 1] - offsets[bucket];
+		if(bucketSize > 1){
+			radixSortFrom<SeparatorFirst>(items + offsets[bucket], buffer + offsets[bucket], keys + offsets[bucket], bucketSize, depth + 1, getString);
+		}
+	}
+}
+
+// Sort items on the string returned for each of them. Large inputs are split on their first
+// differing character, and the resulting buckets sorted in parallel.
+template<bool SeparatorFirst, typename T, typename GetString>
+void sortStrings(std::vector<T>& items, const GetString& getString, unsigned int workerCount){
+	if(items.size() < 2){
+		return;
+	}
+	// Keys of the current character are cached to distribute items without reading their strings again.
+	std::vector<T> buffer(items.size());
+	std::vector<uint16_t> keys(items.size());
+	if(workerCount < 2 || items.size() < parallelSortThreshold){
+		radixSortFrom<SeparatorFirst>(items.data(), buffer.data(), keys.data(), items.size(), 0, getString);
+		return;
+	}
+	size_t depth = 0;
+	size_t offsets[radixBucketCount + 1];
+	if(!partitionByCharacter<SeparatorFirst>(items.data(), buffer.data(), keys.data(), items.size(), depth, offsets, getString)){
+		return;
+	}
+	TaskPool pool(workerCount);
+	for(size_t bucket = 1; bucket < radixBucketCount; ++bucket){
+		const size_t bucketSize = offsets[bucket + 1] - offsets[bucket];
+		if(bucketSize > 1){
+			T* bucketItems = items.data() + offsets[bucket];
+			T* bucketBuffer = buffer.data() + offsets[bucket];
+			uint16_t* bucketKeys = keys.data() + offsets[bucket];
+			pool.push([bucketItems, bucketBuffer, bucketKeys, bucketSize, depth, &getString](unsigned int){
+				radixSortFrom<SeparatorFirst>(bucketItems, bucketBuffer, bucketKeys, bucketSize, depth + 1, getString);
+			}, 0);
+		}
+	}
+	pool.run();
+}
+
+// --------------------------------------------------------------------------------
+//	Exclusion patterns
+// --------------------------------------------------------------------------------
+// Excluded paths are glob patterns relative to the project input directory, matched segment
+// by segment: '*' and '?' match within a name, '[...]' matches a character class and a '**'
+// segment any number of directories. A pattern without wildcards excludes that exact path.
+// As in .gitignore files, a single name with wildcards and no separator, such as *.generated.h,
+// matches at any depth; a leading separator anchors it to the input directory.
+
+// Size of the character class starting at the given position, or zero if it isn't closed.
+size_t matchCharacterClass(std::string_view pattern, size_t start, char c, bool& matched){
+	size_t i = start + 1;
+	const bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+	if(negated){
+		++i;
+	}
+	matched = false;
+	// A leading ']' is part of the class.
+	for(bool first = true; i < pattern.size() && (pattern[i] != ']' || first); first = false){
+		const unsigned char low = (unsigned char)pattern[i];
+		unsigned char high = low;
+		if(i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']'){
+			high = (unsigned char)pattern[i + 2];
+			i += 3;
+		} else {
+			++i;
+		}
+		if(low <= (unsigned char)c && (unsigned char)c <= high){
+			matched = true;
+		}
+	}
+	if(i >= pattern.size()){
+		return 0;
+	}
+	matched = matched != negated;
+	return i + 1 - start;
+}
+
+// Match a name against a single segment pattern, backtracking to the last star only.
+bool matchGlob(std::string_view pattern, std::string_view name){
+	size_t patternPos = 0;
+	size_t namePos = 0;
+	size_t starPos = std::string_view::npos;
+	size_t starNamePos = 0;
+	while(namePos < name.size()){
+		if(patternPos < pattern.size()){
+			const char c = pattern[patternPos];
+			if(c == '*'){
+				starPos = ++patternPos;
+				starNamePos = namePos;
+				continue;
+			}
+			bool matched = c == '?' || c == name[namePos];
+			size_t tokenSize = 1;
+			if(c == '['){
+				bool classMatched = false;
+				const size_t classSize = matchCharacterClass(pattern, patternPos, name[namePos], classMatched);
+				if(classSize != 0){
+					matched = classMatched;
+					tokenSize = classSize;
+				}
+			}
+			if(matched){
+				patternPos += tokenSize;
+				++namePos;
+				continue;
+			}
+		}
+		if(starPos == std::string_view::npos){
+			return false;
+		}
+		patternPos = starPos;
+		namePos = ++starNamePos;
+	}
+	while(patternPos < pattern.size() && pattern[patternPos] == '*'){
+		++patternPos;
+	}
+	return patternPos == pattern.size();
+}
+
+bool isGlobSegment(std::string_view segment){
+	return segment.find_first_of("*?[") != std::string_view::npos;
+}
+
+// Patterns of all the projects of a scan, compiled in a single automaton over path segments.
+// Each state is a set of pattern positions and gives the projects excluding the paths that
+// reach it, so that the walk only carries a state id per directory. States and transitions
+// are built on first use, a transition depending on the literal segment and the wildcard
+// segments matched by the name. Following one costs a lookup of the name among the literal
+// segments, plus one test per wildcard segment active at that state.
+class ExclusionMatcher {
+public:
+
+	// No pattern can match below.
+	static constexpr uint32_t deadState = 0;
+
+	ExclusionMatcher(){
+		nodes.emplace_back();
+	}
+
+	// The prefix is the project input directory, matched literally.
+	void addPattern(std::string_view prefix, std::string_view pattern, ProjectMask projects){
+		uint32_t node = 0;
+		visitSegments(prefix, [&](std::string_view segment){
+			node = literalChild(node, segment);
+		});
+		if(pattern.find_first_of(separators) == std::string_view::npos && isGlobSegment(pattern)){
+			node = anyDepthChild(node);
+		}
+		bool hasSegment = false;
+		visitSegments(pattern, [&](std::string_view segment){
+			hasSegment = true;
+			if(segment == "**"){
+				node = anyDepthChild(node);
+			} else if(isGlobSegment(segment)){
+				node = globChild(node, segment);
+			} else {
+				node = literalChild(node, segment);
+			}
+		});
+		if(hasSegment){
+			nodes[node].excluded |= projects;
+		}
+	}
+
+	// Once all patterns have been added.
+	void compile(){
+		states.clear();
+		stateIds.clear();
+		states.emplace_back();
+		std::vector<uint32_t> rootNodes = { 0 };
+		root = internState(rootNodes);
+	}
+
+	uint32_t rootState() const {
+		return root;
+	}
+
+	// State of an entry from the state of its directory, and the projects excluding the entry.
+	uint32_t next(uint32_t state, std::string_view name, ProjectMask& excluded) const {
+		excluded = 0;
+		if(state == deadState){
+			return deadState;
+		}
+		std::shared_lock<std::shared_mutex> readLock(mutex);
+		const State& current = states[state];
+		const auto literal = current.literalIndices.find(name);
+		const uint32_t literalIndex = literal != current.literalIndices.end() ? literal->second : noIndex;
+		// Transition key: the wildcard segments matched by the name, one bit each, then the literal index.
+		thread_local std::vector<uint64_t> key;
+		key.assign((current.globs.size() + 63) / 64, 0);
+		bool globMatched = false;
+		for(size_t i = 0; i < current.globs.size(); ++i){
+			if(matchGlob(globPatterns[current.globs[i]], name)){
+				key[i / 64] |= uint64_t(1) << (i % 64);
+				globMatched = true;
+			}
+		}
+		if(literalIndex == noIndex && !globMatched && current.loopNodes.empty()){
+			return deadState;
+		}
+		key.push_back(literalIndex);
+		const auto transition = current.transitions.find(key);
+		if(transition != current.transitions.end()){
+			excluded = states[transition->second].excluded;
+			return transition->second;
+		}
+		readLock.unlock();
+
+		std::unique_lock<std::shared_mutex> writeLock(mutex);
+		State& source = states[state];
+		std::vector<uint32_t> targetNodes = source.loopNodes;
+		if(literalIndex != noIndex){
+			targetNodes.insert(targetNodes.end(), source.literalChildren[literalIndex].begin(), source.literalChildren[literalIndex].end());
+		}
+		for(size_t i = 0; i < source.globs.size(); ++i){
+			if(((key[i / 64] >> (i % 64)) & 1u) != 0){
+				targetNodes.insert(targetNodes.end(), source.globChildren[i].begin(), source.globChildren[i].end());
+			}
+		}
+		const uint32_t target = internState(targetNodes);
+		// The deque keeps the source in place when adding states.
+		source.transitions.emplace(key, target);
+		excluded = states[target].excluded;
+		return target;
+	}
+
+private:
+
+	static constexpr uint32_t noIndex = std::numeric_limits<uint32_t>::max();
+
+	struct Node {
+		std::map<std::string, uint32_t, std::less<>> literals;
+		std::vector<std::pair<uint32_t, uint32_t>> globs;
+		// Node following a '**' segment, reached without consuming any segment.
+		uint32_t anyDepthNode = noIndex;
+		// '**' node, staying active on any segment.
+		bool loops = false;
+		ProjectMask excluded = 0;
+	};
+
+	struct State {
+		ProjectMask excluded = 0;
+		std::vector<uint32_t> loopNodes;
+		// Children of the active nodes for each literal segment and each wildcard segment.
+		std::unordered_map<std::string_view, uint32_t> literalIndices;
+		std::vector<std::vector<uint32_t>> literalChildren;
+		std::vector<uint32_t> globs;
+		std::vector<std::vector<uint32_t>> globChildren;
+		std::map<std::vector<uint64_t>, uint32_t> transitions;
+	};
+
+	template<typename Visitor>
+	static void visitSegments(std::string_view path, Visitor&& visitor){
+		size_t start = 0;
+		while(start <= path.size()){
+			size_t end = path.find_first_of(separators, start);
+			if(end == std::string_view::npos){
+				end = path.size();
+			}
+			if(end > start){
+				visitor(path.substr(start, end - start));
+			}
+			start = end + 1;
+		}
+	}
+
+	uint32_t literalChild(uint32_t node, std::string_view segment){
+		const auto child = nodes[node].literals.find(segment);
+		if(child != nodes[node].literals.end()){
+			return child->second;
+		}
+		const uint32_t childNode = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		nodes[node].literals.emplace(std::string(segment), childNode);
+		return childNode;
+	}
+
+	uint32_t globChild(uint32_t node, std::string_view segment){
+		uint32_t globIndex = 0;
+		while(globIndex < globPatterns.size() && globPatterns[globIndex] != segment){
+			++globIndex;
+		}
+		if(globIndex == globPatterns.size()){
+			globPatterns.emplace_back(segment);
+		}
+		for(const std::pair<uint32_t, uint32_t>& glob : nodes[node].globs){
+			if(glob.first == globIndex){
+				return glob.second;
+			}
+		}
+		const uint32_t childNode = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		nodes[node].globs.emplace_back(globIndex, childNode);
+		return childNode;
+	}
+
+	uint32_t anyDepthChild(uint32_t node){
+		if(nodes[node].anyDepthNode == noIndex){
+			const uint32_t childNode = (uint32_t)nodes.size();
+			nodes.emplace_back();
+			nodes.back().loops = true;
+			nodes[node].anyDepthNode = childNode;
+		}
+		return nodes[node].anyDepthNode;
+	}
+
+	// State of a set of nodes, completed with the nodes following their '**' segments.
+	uint32_t internState(std::vector<uint32_t>& stateNodes) const {
+		for(size_t i = 0; i < stateNodes.size(); ++i){
+			if(nodes[stateNodes[i]].anyDepthNode != noIndex){
+				stateNodes.push_back(nodes[stateNodes[i]].anyDepthNode);
+			}
+		}
+		std::sort(stateNodes.begin(), stateNodes.end());
+		stateNodes.erase(std::unique(stateNodes.begin(), stateNodes.end()), stateNodes.end());
+		if(stateNodes.empty()){
+			return deadState;
+		}
+		const auto existingState = stateIds.find(stateNodes);
+		if(existingState != stateIds.end()){
+			return existingState->second;
+		}
+
+		State state;
+		for(const uint32_t node : stateNodes){
+			const Node& stateNode = nodes[node];
+			state.excluded |= stateNode.excluded;
+			if(stateNode.loops){
+				state.loopNodes.push_back(node);
+			}
+			for(const auto& literal : stateNode.literals){
+				const auto index = state.literalIndices.emplace(literal.first, (uint32_t)state.literalChildren.size());
+				if(index.second){
+					state.literalChildren.emplace_back();
+				}
+				state.literalChildren[index.first->second].push_back(literal.second);
+			}
+			for(const std::pair<uint32_t, uint32_t>& glob : stateNode.globs){
+				const size_t index = (size_t)(std::find(state.globs.begin(), state.globs.end(), glob.first) - state.globs.begin());
+				if(index == state.globs.size()){
+					state.globs.push_back(glob.first);
+					state.globChildren.emplace_back();
+				}
+				state.globChildren[index].push_back(glob.second);
+			}
+		}
+		// A state without transitions only matters for the projects excluding it.
+		if(state.loopNodes.empty() && state.literalChildren.empty() && state.globs.empty() && state.excluded == 0){
+			return deadState;
+		}
+		const uint32_t id = (uint32_t)states.size();
+		states.emplace_back(std::move(state));
+		stateIds.emplace(stateNodes, id);
+		return id;
+	}
+
+#ifdef _WIN32
+	static constexpr const char* separators = "/\\";
+#else
+	static constexpr const char* separators = "/";
+#endif
+
+	std::vector<Node> nodes;
+	std::vector<std::string> globPatterns;
+	uint32_t root = deadState;
+
+	mutable std::deque<State> states;
+	mutable std::map<std::vector<uint32_t>, uint32_t> stateIds;
+	mutable std::shared_mutex mutex;
+};
+
+// --------------------------------------------------------------------------------
+//	Ignore files
+// --------------------------------------------------------------------------------
+// Rules of the .gitignore files found from the input directory down: a rule without slash
+// matches a name at any depth, other rules a path relative to their file. A trailing slash
+// restricts a rule to directories and a leading '!' re-includes entries. The last matching
+// rule wins, deeper files taking precedence.
+
+struct IgnoreRule {
+	std::vector<std::string> segments;
+	bool negated = false;
+	bool directoryOnly = false;
+	// Single segment matched against the entry name.
+	bool nameOnly = false;
+};
+
+// Rules of a .gitignore file, chained to the ones of the parent directories.
+struct IgnoreRules {
+	std::shared_ptr<const IgnoreRules> parent;
+	// Number of segments in the relative path of the directory containing the file.
+	size_t depth = 0;
+	std::vector<IgnoreRule> rules;
+};
+
+bool parseIgnoreRule(std::string line, IgnoreRule& rule){
+	if(!line.empty() && line.back() == '\r'){
+		line.pop_back();
+	}
+	// Trailing spaces are ignored unless escaped.
+	while(!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')){
+		line.pop_back();
+	}
+	if(line.empty() || line[0] == '#'){
+		return false;
+	}
+	if(line[0] == '!'){
+		rule.negated = true;
+		line.erase(0, 1);
+	} else if(line[0] == '\\'){
+		line.erase(0, 1);
+	}
+	if(!line.empty() && line.back() == '/'){
+		rule.directoryOnly = true;
+		line.pop_back();
+	}
+	const bool anchored = line.find('/') != std::string::npos;
+	for(const std::string& segment : split(line, "/", true)){
+		if(!segment.empty()){
+			rule.segments.push_back(segment);
+		}
+	}
+	if(rule.segments.empty()){
+		return false;
+	}
+	rule.nameOnly = !anchored && rule.segments.size() == 1;
+	return true;
+}
+
+// Rules of the directory if it has a .gitignore file, else the parent rules.
+std::shared_ptr<const IgnoreRules> loadIgnoreRules(const fs::path& dirPath, const std::string& relativeDir, const std::shared_ptr<const IgnoreRules>& parent){
+	std::ifstream file(dirPath / ".gitignore");
+	if(!file.is_open()){
+		return parent;
+	}
+	std::shared_ptr<IgnoreRules> rules = std::make_shared<IgnoreRules>();
+	std::string line;
+	while(std::getline(file, line)){
+		IgnoreRule rule;
+		if(parseIgnoreRule(line, rule)){
+			rules->rules.emplace_back(std::move(rule));
+		}
+	}
+	if(rules->rules.empty()){
+		return parent;
+	}
+	rules->parent = parent;
+	rules->depth = relativeDir.empty() ? 0 : (size_t)std::count(relativeDir.begin(), relativeDir.end(), (char)fs::path::preferred_separator) + 1;
+	return rules;
+}
+
+// Match path segments against rule segments, a trailing '**' requiring at least one segment.
+bool matchIgnoreSegments(const std::vector<std::string>& pattern, size_t patternIndex, const std::string_view* segments, size_t segmentCount){
+	if(patternIndex == pattern.size()){
+		return segmentCount == 0;
+	}
+	if(pattern[patternIndex] == "**"){
+		if(patternIndex + 1 == pattern.size()){
+			return segmentCount != 0;
+		}
+		for(size_t skipped = 0; skipped <= segmentCount; ++skipped){
+			if(matchIgnoreSegments(pattern, patternIndex + 1, segments + skipped, segmentCount - skipped)){
+				return true;
+			}
+		}
+		return false;
+	}
+	return segmentCount != 0 && matchGlob(pattern[patternIndex], segments[0]) && matchIgnoreSegments(pattern, patternIndex + 1, segments + 1, segmentCount - 1);
+}
+
+// Is an entry of a directory ignored by the rules of that directory and its parents.
+bool isIgnoredEntry(const IgnoreRules* rules, std::string_view relativeDir, std::string_view name, bool directory){
+	if(rules == nullptr){
+		return false;
+	}
+	thread_local std::vector<std::string_view> segments;
+	segments.clear();
+	for(size_t start = 0; start < relativeDir.size();){
+		size_t end = relativeDir.find((char)fs::path::preferred_separator, start);
+		if(end == std::string_view::npos){
+			end = relativeDir.size();
+		}
+		segments.push_back(relativeDir.substr(start, end - start));
+		start = end + 1;
+	}
+	segments.push_back(name);
+	for(const IgnoreRules* level = rules; level != nullptr; level = level->parent.get()){
+		for(auto rule = level->rules.rbegin(); rule != level->rules.rend(); ++rule){
+			if(rule->directoryOnly && !directory){
+				continue;
+			}
+			const bool matched = rule->nameOnly ? matchGlob(rule->segments[0], name) :
+				matchIgnoreSegments(rule->segments, 0, segments.data() + level->depth, segments.size() - level->depth);
+			if(matched){
+				return !rule->negated;
+			}
+		}
+	}
+	return false;
+}
+
+// --------------------------------------------------------------------------------
+//	Directory scan
+// --------------------------------------------------------------------------------
+
+// Small set of names with a value each, bucketed by length and compared in place, ASCII letters
+// being optionally compared without case.
+template<typename Value>
+class NameTable {
+public:
+
+	explicit NameTable(bool aCaseInsensitive = false) : caseInsensitive(aCaseInsensitive) {}
+
+	// Value of a name, added if needed.
+	Value& insert(std::string_view name){
+		if(name.size() >= buckets.size()){
+			buckets.resize(name.size() + 1);
+		}
+		std::vector<Entry>& bucket = buckets[name.size()];
+		for(Entry& entry : bucket){
+			if(equals(entry.name, name)){
+				return entry.value;
+			}
+		}
+		bucket.push_back({ std::string(name), Value() });
+		return bucket.back().value;
+	}
+
+	const Value* find(std::string_view name) const {
+		if(name.size() >= buckets.size()){
+			return nullptr;
+		}
+		for(const Entry& entry : buckets[name.size()]){
+			if(equals(entry.name, name)){
+				return &entry.value;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+
+	struct Entry {
+		std::string name;
+		Value value;
+	};
+
+	// Names have the same size. The last characters are the most discriminating for extensions.
+	bool equals(std::string_view nameA, std::string_view nameB) const {
+		for(size_t i = nameA.size(); i-- > 0;){
+			const char charA = nameA[i];
+			const char charB = nameB[i];
+			if(charA != charB && !(caseInsensitive && toLowerASCII(charA) == toLowerASCII(charB))){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static char toLowerASCII(char c){
+		return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+	}
+
+	std::vector<std::vector<Entry>> buckets;
+	bool caseInsensitive;
+};
+
+// Projects compiling and including files with a given extension.
+struct ExtensionProjects {
+	ProjectMask compileMask = 0;
+	ProjectMask includeMask = 0;
+};
+
+// Several projects can share a scan, each one covering the subtree of its input directory.
+// Their settings apply to paths relative to that input directory.
+struct ProjectScanSettings {
+	// Path of the project input directory relative to the scanned directory.
+	std::string rootPath;
+	std::unordered_set<std::string> compileExtensions;
+	std::unordered_set<std::string> includeExtensions;
+	std::unordered_set<std::string> excludedPatterns;
+	std::vector<std::string> generatedFilenames;
+	bool noExtensionFilter = false;
+};
+
+const size_t maxProjectsPerScan = sizeof(ProjectMask) * 8;
+
+struct ScanSettings {
+	fs::path inputDirPath;
+	std::vector<ProjectScanSettings> projects;
+	// Projects whose input directory is a given path, and parents of these paths.
+	std::unordered_map<std::string, ProjectMask> projectRoots;
+	std::unordered_set<std::string> projectRootParents;
+	// Exclusion patterns of all projects, shared by copies of the settings.
+	std::shared_ptr<ExclusionMatcher> exclusions;
+	// Skip entries ignored by .gitignore files.
+	bool gitignore = false;
+	// Skip hidden and metadata directories.
+	bool pruneMetadataDirs = true;
+	// Extensions of all projects, built with the projects.
+	bool caseInsensitiveExtensions = false;
+	NameTable<ExtensionProjects> extensionProjects;
+	NameTable<ProjectMask> generatedFilenameProjects;
+	ProjectMask noExtensionFilterProjects = 0;
+	bool nativeBackend = false;
+	// Unchanged directories are replayed from the previous index if present.
+	const ScanIndex* previousIndex = nullptr;
+	bool recordIndex = false;
+	int64_t scanStartTime = 0;
+
+	// Register the project input directories, compile exclusion patterns and gather extensions,
+	// once all projects have been added.
+	void finalizeProjects(){
+		projectRoots.clear();
+		projectRootParents.clear();
+		exclusions = std::make_shared<ExclusionMatcher>();
+		extensionProjects = NameTable<ExtensionProjects>(caseInsensitiveExtensions);
+		generatedFilenameProjects = NameTable<ProjectMask>();
+		noExtensionFilterProjects = 0;
+		for(size_t i = 0; i < projects.size(); ++i){
+			const ProjectMask projectBit = ProjectMask(1) << i;
+			for(const std::string& extension : projects[i].compileExtensions){
+				extensionProjects.insert(extension).compileMask |= projectBit;
+			}
+			for(const std::string& extension : projects[i].includeExtensions){
+				extensionProjects.insert(extension).includeMask |= projectBit;
+			}
+			for(const std::string& filename : projects[i].generatedFilenames){
+				generatedFilenameProjects.insert(filename) |= projectBit;
+			}
+			if(projects[i].noExtensionFilter){
+				noExtensionFilterProjects |= projectBit;
+			}
+			const std::string& rootPath = projects[i].rootPath;
+			for(const std::string& pattern : projects[i].excludedPatterns){
+				exclusions->addPattern(rootPath, pattern, ProjectMask(1) << i);
+			}
+			projectRoots[rootPath] |= ProjectMask(1) << i;
+			for(size_t separator = rootPath.find((char)fs::path::preferred_separator); separator != std::string::npos; separator = rootPath.find((char)fs::path::preferred_separator, separator + 1)){
+				projectRootParents.insert(rootPath.substr(0, separator));
+			}
+			if(!rootPath.empty()){
+				projectRootParents.insert(std::string());
+			}
+		}
+		exclusions->compile();
+	}
+};
+
+// Any setting that changes which entries are kept invalidates the index.
+uint64_t hashScanSettings(const ScanSettings& settings){
+	auto appendSorted = [](std::string& key, const auto& items){
+		std::vector<std::string> sortedItems(items.begin(), items.end());
+		std::sort(sortedItems.begin(), sortedItems.end());
+		for(const std::string& item : sortedItems){
+			key.append(item);
+			key.push_back('\0');
+		}
+		key.push_back('\n');
+	};
+	std::error_code error;
+	std::string key = fs::absolute(settings.inputDirPath, error).lexically_normal().string();
+	key.append(settings.nativeBackend ? "\nnative\n" : "\nstd\n");
+	key.append(settings.pruneMetadataDirs ? "prune\n" : "\n");
+	key.append(settings.caseInsensitiveExtensions ? "nocase\n" : "\n");
+	for(const ProjectScanSettings& project : settings.projects){
+		key.append(project.rootPath);
+		key.push_back('\n');
+		appendSorted(key, project.compileExtensions);
+		appendSorted(key, project.includeExtensions);
+		appendSorted(key, project.excludedPatterns);
+		appendSorted(key, project.generatedFilenames);
+	}
+	return hashString(key);
+}
+
+// Current time in the clock of the modification times reported by the backend.
+int64_t currentScanTime(const ScanSettings& settings){
+#ifdef VISUALGEN_NATIVE_SCAN
+	if(settings.nativeBackend){
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		return (int64_t)now.tv_sec * 1000000000ll + (int64_t)now.tv_nsec;
+	}
+#else
+	(void)settings;
+#endif
+	return toNanoseconds(fs::file_time_type::clock::now().time_since_epoch());
+}
+
+// Relative paths are built during traversal by appending names to the parent relative path,
+// the input directory itself being the empty path.
+std::string appendRelativePath(std::string_view relativeDir, std::string_view name){
+	if(relativeDir.empty()){
+		return std::string(name);
+	}
+	std::string path;
+	path.reserve(relativeDir.size() + 1 + name.size());
+	path.append(relativeDir);
+	path.push_back((char)fs::path::preferred_separator);
+	path.append(name);
+	return path;
+}
+
+const uint32_t noDirectoryId = std::numeric_limits<uint32_t>::max();
+
+// Scanned directories, identified by their index once the scan is complete.
+// Paths and filters are only built for the directories that need them.
+class DirectoryTable {
+public:
+
+	// The name must outlive the table.
+	void add(uint32_t id, uint32_t parentId, std::string_view name){
+		entries.push_back({ id, parentId, name, std::string_view(), std::string_view(), false });
+	}
+
+	void merge(DirectoryTable& other){
+		entries.insert(entries.end(), std::make_move_iterator(other.entries.begin()), std::make_move_iterator(other.entries.end()));
+		other.entries.clear();
+	}
+
+	// Place each directory at its id. Ids are given in scan order,
+	// so a parent always comes before its children.
+	void finalize(){
+		for(size_t i = 0; i < entries.size(); ++i){
+			while(entries[i].id != i){
+				std::swap(entries[i], entries[entries[i].id]);
+			}
+		}
+	}
+
+	size_t size() const {
+		return entries.size();
+	}
+
+	uint32_t parent(uint32_t id) const {
+		return entries[id].parentId;
+	}
+
+	// Build the relative path and filter of a directory, its parent being already materialized.
+	void materialize(uint32_t id, StringArena& strings){
+		Entry& entry = entries[id];
+		if(entry.materialized){
+			return;
+		}
+		if(entry.parentId == noDirectoryId){
+			std::string filter(entry.name);
+			replace(filter, "/", "\\");
+			entry.path = entry.name;
+			entry.filter = strings.append(filter);
+		} else {
+			const Entry& parentEntry = entries[entry.parentId];
+			entry.path = strings.append(parentEntry.path, (char)fs::path::preferred_separator, entry.name);
+			entry.filter = strings.append(parentEntry.filter, '\\', entry.name);
+		}
+		entry.materialized = true;
+	}
+
+	std::string_view path(uint32_t id) const {
+		return entries[id].path;
+	}
+
+	std::string_view filter(uint32_t id) const {
+		return entries[id].filter;
+	}
+
+private:
+
+	struct Entry {
+		uint32_t id;
+		uint32_t parentId;
+		std::string_view name;
+		std::string_view path;
+		std::string_view filter;
+		bool materialized;
+	};
+
+	std::vector<Entry> entries;
+};
+
+// A file kept by at least one project.
+struct ScannedFile {
+	uint32_t directoryId;
+	std::string_view name;
+	ProjectMask compileMask;
+	ProjectMask includeMask;
+};
+
+// Names and paths are stored in the results arena.
+struct ScanResults {
+	StringArena strings;
+	DirectoryTable directories;
+	std::vector<ScannedFile> files;
+	std::vector<IndexDirectoryRecord> directoryRecords;
+	size_t unreadableDirCount = 0;
+	size_t prunedDirCount = 0;
+	size_t reusedDirCount = 0;
+	// Running out of descriptors makes the results incomplete, it isn't a property of the tree.
+	bool outOfDescriptors = false;
+
+	void merge(ScanResults& other){
+		strings.merge(other.strings);
+		directories.merge(other.directories);
+		files.insert(files.end(), std::make_move_iterator(other.files.begin()), std::make_move_iterator(other.files.end()));
+		directoryRecords.insert(directoryRecords.end(), std::make_move_iterator(other.directoryRecords.begin()), std::make_move_iterator(other.directoryRecords.end()));
+		unreadableDirCount += other.unreadableDirCount;
+		prunedDirCount += other.prunedDirCount;
+		reusedDirCount += other.reusedDirCount;
+		outOfDescriptors = outOfDescriptors || other.outOfDescriptors;
+	}
+};
+
+// Shared by the tasks of a scan, each worker filling its own results.
+struct ScanState {
+	const ScanSettings& settings;
+	TaskPool pool;
+	std::vector<ScanResults> workerResults;
+	std::atomic<uint32_t> directoryCount;
+
+	ScanState(const ScanSettings& aSettings, unsigned int workerCount) :
+		settings(aSettings), pool(workerCount), workerResults(pool.workerCount()), directoryCount(0) {}
+
+	// Register a directory in the results of the worker scanning it, its name being stored in an arena.
+	uint32_t addDirectory(uint32_t parentId, std::string_view name, unsigned int workerId){
+		const uint32_t id = directoryCount++;
+		workerResults[workerId].directories.add(id, parentId, name);
+		return id;
+	}
+};
+
+// Path relative to the input directory of a project containing it.
+std::string projectRelativePath(const ProjectScanSettings& project, const std::string& path){
+	if(project.rootPath.empty()){
+		return path;
+	}
+	return path.size() > project.rootPath.size() ? path.substr(project.rootPath.size() + 1) : std::string();
+}
+
+template<typename Visitor>
+void visitProjects(ProjectMask mask, Visitor&& visitor){
+	while(mask != 0){
+		size_t index = 0;
+		while(((mask >> index) & 1u) == 0){
+			++index;
+		}
+		visitor(index);
+		mask &= ~(ProjectMask(1) << index);
+	}
+}
+
+// Projects covering a subdirectory, among the ones covering its parent, and its exclusion state.
+ProjectMask subdirectoryProjects(const ScanSettings& settings, ProjectMask parentMask, uint32_t parentExclusionState, const std::string& entryPath, uint32_t& exclusionState){
+	const size_t separator = entryPath.rfind((char)fs::path::preferred_separator);
+	const std::string_view name = separator == std::string::npos ? std::string_view(entryPath) : std::string_view(entryPath).substr(separator + 1);
+	// Skip directory if it is excluded by a pattern of the project.
+	ProjectMask excluded;
+	exclusionState = settings.exclusions->next(parentExclusionState, name, excluded);
+	ProjectMask mask = parentMask & ~excluded;
+	if(settings.projectRoots.size() > 1 || !settings.projectRoots.begin()->first.empty()){
+		auto root = settings.projectRoots.find(entryPath);
+		if(root != settings.projectRoots.end()){
+			mask |= root->second;
+		}
+	}
+	return mask;
+}
+
+// A directory is listed if it belongs to a project or leads to the input directory of one.
+bool isScannedDirectory(const ScanSettings& settings, ProjectMask mask, const std::string& entryPath){
+	return mask != 0 || settings.projectRootParents.count(entryPath) != 0;
+}
+
+// Projects covering a directory and its exclusion state, from the scanned directory down.
+ProjectMask projectsAlongPath(const ScanSettings& settings, const std::string& relativePath, uint32_t& exclusionState){
+	auto root = settings.projectRoots.find(std::string());
+	ProjectMask mask = root != settings.projectRoots.end() ? root->second : 0;
+	exclusionState = settings.exclusions->rootState();
+	if(relativePath.empty()){
+		return mask;
+	}
+	for(size_t separator = relativePath.find((char)fs::path::preferred_separator); ; separator = relativePath.find((char)fs::path::preferred_separator, separator + 1)){
+		mask = subdirectoryProjects(settings, mask, exclusionState, relativePath.substr(0, separator), exclusionState);
+		if(separator == std::string::npos){
+			break;
+		}
+	}
+	return mask;
+}
+
+// Ignore rules of the parent directories of a path, read from disk.
+std::shared_ptr<const IgnoreRules> ignoreRulesAbove(const ScanSettings& settings, const std::string& relativePath){
+	std::shared_ptr<const IgnoreRules> rules;
+	if(!settings.gitignore || relativePath.empty()){
+		return rules;
+	}
+	rules = loadIgnoreRules(settings.inputDirPath, std::string(), rules);
+	for(size_t separator = relativePath.find((char)fs::path::preferred_separator); separator != std::string::npos; separator = relativePath.find((char)fs::path::preferred_separator, separator + 1)){
+		const std::string parentPath = relativePath.substr(0, separator);
+		rules = loadIgnoreRules(settings.inputDirPath / parentPath, parentPath, rules);
+	}
+	return rules;
+}
+
+bool isHiddenFilename(std::string_view entryName){
+	// Skip hidden
+	return entryName.empty() || entryName[0] == '.';
+}
+
+// Hidden directories (.git, .svn, .hg, .vs, .idea...) and other version control or IDE metadata directories.
+bool isMetadataDirectoryName(std::string_view entryName){
+	static const std::string_view metadataNames[] = { "CVS", "_darcs", "_svn", "ipch" };
+	return isHiddenFilename(entryName) || std::find(std::begin(metadataNames), std::end(metadataNames), entryName) != std::end(metadataNames);
+}
+
+// Metadata directories are skipped unless disabled, or if they lead to a project input directory.
+bool isPrunedDirectory(const ScanSettings& settings, std::string_view entryName, const std::string& entryPath){
+	if(!settings.pruneMetadataDirs || !isMetadataDirectoryName(entryName)){
+		return false;
+	}
+	return settings.projectRoots.count(entryPath) == 0 && settings.projectRootParents.count(entryPath) == 0;
+}
+
+// Extension as returned by fs::path::extension, for names that are not hidden.
+std::string_view filenameExtension(std::string_view entryName){
+	const size_t dotPos = entryName.rfind('.');
+	return (dotPos == std::string_view::npos || dotPos == 0) ? std::string_view() : entryName.substr(dotPos);
+}
+
+// Name of the output a temporary file "<output>.<pid>.tmp" is written for, or the name itself.
+// Keeps the index valid across runs, which name their temporary files differently.
+std::string_view temporaryFileTarget(std::string_view name){
+	const std::string_view suffix = ".tmp";
+	if(name.size() <= suffix.size() || name.substr(name.size() - suffix.size()) != suffix){
+		return name;
+	}
+	const size_t digitsEnd = name.size() - suffix.size();
+	size_t digitsStart = digitsEnd;
+	while(digitsStart > 0 && name[digitsStart - 1] >= '0' && name[digitsStart - 1] <= '9'){
+		--digitsStart;
+	}
+	if(digitsStart == digitsEnd || digitsStart < 2 || name[digitsStart - 1] != '.'){
+		return name;
+	}
+	return name.substr(0, digitsStart - 1);
+}
+
+// Compile and include masks of a file among the projects covering its directory, based on its name only.
+// The extension is looked up once for all projects, without allocating.
+void classifyFilename(const ScanSettings& settings, ProjectMask mask, uint32_t exclusionState, std::string_view entryName, ProjectMask& compileMask, ProjectMask& includeMask){
+	compileMask = 0;
+	includeMask = 0;
+	if(isHiddenFilename(entryName)){
+		return;
+	}
+	ProjectMask excluded;
+	settings.exclusions->next(exclusionState, entryName, excluded);
+	mask &= ~excluded;
+	// Skip generated files, and the temporary files they are written to.
+	const ProjectMask* generatedProjects = settings.generatedFilenameProjects.find(temporaryFileTarget(entryName));
+	if(generatedProjects != nullptr){
+		mask &= ~*generatedProjects;
+	}
+	// If no filter, assume everything is compiled.
+	compileMask = mask & settings.noExtensionFilterProjects;
+	const ExtensionProjects* extensionProjects = settings.extensionProjects.find(filenameExtension(entryName));
+	if(extensionProjects != nullptr){
+		compileMask |= mask & extensionProjects->compileMask;
+		includeMask = mask & extensionProjects->includeMask;
+	}
+}
+
+void processFile(const ScanSettings& settings, ProjectMask mask, uint32_t exclusionState, uint32_t directoryId, std::string_view entryName, ScanResults& results, IndexDirectoryRecord& record){
+	ProjectMask compileMask;
+	ProjectMask includeMask;
+	classifyFilename(settings, mask, exclusionState, entryName, compileMask, includeMask);
+	if((compileMask | includeMask) == 0){
+		return;
+	}
+	const std::string_view name = results.strings.append(entryName);
+	results.files.push_back({ directoryId, name, compileMask, includeMask });
+	if(settings.recordIndex){
+		record.files.push_back({ compileMask, includeMask, name });
+	}
+}
+
+void finishDirectoryRecord(const ScanSettings& settings, IndexDirectoryRecord& record, ScanResults& results){
+	if(!settings.recordIndex){
+		return;
+	}
+	// Don't trust a time that could still change within the timestamp granularity.
+	if(record.modificationTime > settings.scanStartTime - racyTimeWindow){
+		record.modificationTime = unknownTime;
+	}
+	results.directoryRecords.emplace_back(std::move(record));
+}
+
+// Replay the content of an unmodified directory from the previous index, without listing it.
+bool replayIndexedDirectory(const ScanSettings& settings, const std::string& relativeDir, uint32_t directoryId, int64_t modificationTime, ScanResults& results, const std::function<bool(std::string_view)>& pushSubdirectory){
+	std::string_view record;
+	IndexReader reader;
+	if(settings.previousIndex == nullptr || !settings.previousIndex->find(relativeDir, modificationTime, record, reader)){
+		return false;
+	}
+	// The index has been validated when loaded.
+	uint32_t count = 0;
+	std::string_view name;
+	reader.read(count);
+	for(uint32_t i = 0; i < count; ++i){
+		reader.readString(name);
+		pushSubdirectory(name);
+	}
+	reader.read(count);
+	ScannedFile file;
+	file.directoryId = directoryId;
+	for(uint32_t i = 0; i < count; ++i){
+		reader.readVarint(file.compileMask);
+		reader.readVarint(file.includeMask);
+		reader.readString(name);
+		file.name = results.strings.append(name);
+		results.files.push_back(file);
+	}
+	if(settings.recordIndex){
+		IndexDirectoryRecord previousRecord;
+		previousRecord.previousRecord = record;
+		results.directoryRecords.emplace_back(std::move(previousRecord));
+	}
+	++results.reusedDirCount;
+	return true;
+}
+
+enum class EntryType {
+	File, Directory, Other
+};
+
+enum class ListStatus {
+	Listed, Unreadable, OutOfDescriptors
+};
+
+ListStatus listFailure(const std::error_code& error){
+	if(error == std::errc::too_many_files_open || error == std::errc::too_many_files_open_in_system){
+		return ListStatus::OutOfDescriptors;
+	}
+	return ListStatus::Unreadable;
+}
+
+void countListFailure(ListStatus status, ScanResults& results){
+	if(status == ListStatus::OutOfDescriptors){
+		results.outOfDescriptors = true;
+	} else {
+		++results.unreadableDirCount;
+	}
+}
+
+// Walk of one directory shared by the backends, which only differ in how they list directories.
+// The directory is replayed from the previous index if unmodified, otherwise listed: files are
+// classified and the scanned subdirectories queued as new tasks. The backend directory provides:
+//	path(settings): its path, for ignore files;
+//	modificationTime(): in the clock of the backend, or unknownTime;
+//	list(keepFile, visit): call visit(name, type) for each entry, keepFile(name) telling whether
+//		a name would be kept as a file, for entries costly to resolve. Returns the ListStatus;
+//	pushSubdirectory(state, name, entryPath, parentId, mask, exclusionState, ignoreRules, workerId).
+template<typename Directory>
+void scanListedDirectory(ScanState& state, Directory& directory, const std::string& relativeDir, uint32_t directoryId, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, unsigned int workerId){
+	const ScanSettings& settings = state.settings;
+	ScanResults& results = state.workerResults[workerId];
+	const std::shared_ptr<const IgnoreRules> ignoreRules = settings.gitignore ? loadIgnoreRules(directory.path(settings), relativeDir, parentIgnoreRules) : nullptr;
+	IndexDirectoryRecord record;
+	// Returns false if the subdirectory isn't scanned.
+	auto pushSubdirectory = [&](std::string_view subdirName){
+		if(isIgnoredEntry(ignoreRules.get(), relativeDir, subdirName, true)){
+			return false;
+		}
+		std::string entryPath = appendRelativePath(relativeDir, subdirName);
+		if(isPrunedDirectory(settings, subdirName, entryPath)){
+			// Recorded to be counted again when the directory is replayed.
+			if(settings.recordIndex){
+				record.subdirectories.push_back(results.strings.append(subdirName));
+			}
+			++results.prunedDirCount;
+			return false;
+		}
+		uint32_t subdirExclusionState;
+		const ProjectMask subdirMask = subdirectoryProjects(settings, mask, exclusionState, entryPath, subdirExclusionState);
+		if(!isScannedDirectory(settings, subdirMask, entryPath)){
+			return false;
+		}
+		const std::string_view entryName = results.strings.append(subdirName);
+		if(settings.recordIndex){
+			record.subdirectories.push_back(entryName);
+		}
+		directory.pushSubdirectory(state, entryName, std::move(entryPath), directoryId, subdirMask, subdirExclusionState, ignoreRules, workerId);
+		return true;
+	};
+
+	if(settings.previousIndex != nullptr || settings.recordIndex){
+		record.modificationTime = directory.modificationTime();
+		if(replayIndexedDirectory(settings, relativeDir, directoryId, record.modificationTime, results, pushSubdirectory)){
+			return;
+		}
+	}
+	record.relativePath = relativeDir;
+	const ListStatus status = directory.list([&](std::string_view entryName){
+		ProjectMask compileMask;
+		ProjectMask includeMask;
+		classifyFilename(settings, mask, exclusionState, entryName, compileMask, includeMask);
+		return (compileMask | includeMask) != 0;
+	}, [&](std::string_view entryName, EntryType type){
+		if(type == EntryType::Directory){
+			pushSubdirectory(entryName);
+		} else if(type == EntryType::File && !isIgnoredEntry(ignoreRules.get(), relativeDir, entryName, false)){
+			processFile(settings, mask, exclusionState, directoryId, entryName, results, record);
+		}
+	});
+	if(status != ListStatus::Listed){
+		countListFailure(status, results);
+		return;
+	}
+	finishDirectoryRecord(settings, record, results);
+}
+
+// List a directory with the standard library, never following directory symlinks
+// as the recursive iterator did.
+template<typename Visitor>
+ListStatus listDirectoryEntries(const fs::path& dirPath, Visitor visit){
+	std::error_code error;
+	fs::directory_iterator filesIterator(dirPath, error);
+	if(error){
+		return listFailure(error);
+	}
+	for(const fs::directory_entry& entry : filesIterator){
+		const std::string entryName = entry.path().filename().string();
+		if(entry.is_regular_file(error)){
+			visit(entryName, EntryType::File);
+		} else if(entry.is_directory(error) && !entry.is_symlink(error)){
+			visit(entryName, EntryType::Directory);
+		}
+	}
+	return ListStatus::Listed;
+}
+
+void scanDirectory(ScanState& state, const fs::path& dirPath, const std::string& relativeDir, uint32_t parentId, std::string_view name, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, unsigned int workerId);
+
+// Directory listed with the standard library.
+struct StandardDirectory {
+	const fs::path& dirPath;
+
+	const fs::path& path(const ScanSettings&) const {
+		return dirPath;
+	}
+
+	int64_t modificationTime() const {
+		std::error_code error;
+		const fs::file_time_type time = fs::last_write_time(dirPath, error);
+		return error ? unknownTime : toNanoseconds(time.time_since_epoch());
+	}
+
+	template<typename KeepFile, typename Visitor>
+	ListStatus list(KeepFile, Visitor visit) const {
+		return listDirectoryEntries(dirPath, visit);
+	}
+
+	void pushSubdirectory(ScanState& state, std::string_view entryName, std::string&& entryPath, uint32_t directoryId, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& ignoreRules, unsigned int workerId) const {
+		const fs::path subdirPath = dirPath / entryName;
+		state.pool.push([&state, subdirPath, entryPath = std::move(entryPath), directoryId, entryName, mask, exclusionState, ignoreRules](unsigned int id){
+			scanDirectory(state, subdirPath, entryPath, directoryId, entryName, mask, exclusionState, ignoreRules, id);
+		}, workerId);
+	}
+};
+
+// List one directory, classify its files and queue its subdirectories as new tasks.
+void scanDirectory(ScanState& state, const fs::path& dirPath, const std::string& relativeDir, uint32_t parentId, std::string_view name, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, unsigned int workerId){
+	const uint32_t directoryId = state.addDirectory(parentId, name, workerId);
+	StandardDirectory directory = { dirPath };
+	scanListedDirectory(state, directory, relativeDir, directoryId, mask, exclusionState, parentIgnoreRules, workerId);
+}
+
+#ifdef VISUALGEN_NATIVE_SCAN
+
+// Layout of the records returned by getdents64, not exposed by the libc headers.
+struct LinuxDirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+// An open directory, kept alive until all its subdirectories have been opened relative to it.
+struct NativeDirectory {
+	int fd = -1;
+	std::string relativePath;
+
+	NativeDirectory(int aFd, const std::string& aRelativePath) : fd(aFd), relativePath(aRelativePath) {}
+	~NativeDirectory(){
+		if(fd >= 0){
+			close(fd);
+		}
+	}
+};
+
+// Resolve the type of entries that getdents64 couldn't classify, following file symlinks
+// like directory_entry::is_regular_file does, but never directory symlinks.
+EntryType queryNativeEntryType(int dirFd, const char* name, unsigned char type){
+	struct stat status;
+	if(type == DT_UNKNOWN){
+		if(fstatat(dirFd, name, &status, AT_SYMLINK_NOFOLLOW) != 0){
+			return EntryType::Other;
+		}
+		if(S_ISREG(status.st_mode)){
+			return EntryType::File;
+		}
+		if(S_ISDIR(status.st_mode)){
+			return EntryType::Directory;
+		}
+		if(!S_ISLNK(status.st_mode)){
+			return EntryType::Other;
+		}
+	}
+	if(fstatat(dirFd, name, &status, 0) != 0){
+		return EntryType::Other;
+	}
+	return S_ISREG(status.st_mode) ? EntryType::File : EntryType::Other;
+}
+
+#ifdef VISUALGEN_IO_URING
+// One status queue per worker thread, opened on first use. After a failure, requests can be
+// left in flight with the tags of released entries: the queue is then never waited on again.
+struct WorkerStatQueue {
+	StatQueue queue;
+	bool usable;
+
+	WorkerStatQueue() : usable(queue.open(statQueueDepth)) {}
+};
+
+WorkerStatQueue& workerStatQueue(){
+	thread_local WorkerStatQueue workerQueue;
+	return workerQueue;
+}
+#endif
+
+// List a directory with getdents64. Symlinks are only resolved if their name would be kept as a file.
+template<typename KeepFile, typename Visitor>
+ListStatus listNativeEntries(int fd, KeepFile keepFile, Visitor visit){
+	// Entries that getdents64 couldn't classify are resolved by the kernel asynchronously while
+	// the listing goes on, and visited as their status arrives. Symlinks found among them are
+	// followed in a second round. Without io_uring, or once it failed, they are queried one at a time.
+#ifdef VISUALGEN_IO_URING
+	WorkerStatQueue& workerQueue = workerStatQueue();
+	StatQueue* statQueue = workerQueue.usable ? &workerQueue.queue : nullptr;
+	struct PendingEntry {
+		const char* name;
+		bool followLink;
+		bool resolved;
+	};
+	std::vector<PendingEntry> pendingEntries;
+	std::vector<size_t> linkEntries;
+	auto querySync = [&](const PendingEntry& entry){
+		visit(entry.name, queryNativeEntryType(fd, entry.name, entry.followLink ? DT_LNK : DT_UNKNOWN));
+	};
+	auto onStatus = [&](uint64_t tag, int error, uint32_t mode){
+		PendingEntry& entry = pendingEntries[tag];
+		if(error != 0){
+			// Only vanished entries are skipped, other failures are queried again.
+			if(!isMissingPathError(error)){
+				querySync(entry);
+			}
+			entry.resolved = true;
+			return;
+		}
+		if(S_ISLNK(mode) && !entry.followLink){
+			entry.followLink = true;
+			linkEntries.push_back((size_t)tag);
+			return;
+		}
+		entry.resolved = true;
+		if(S_ISREG(mode)){
+			visit(entry.name, EntryType::File);
+		} else if(S_ISDIR(mode) && !entry.followLink){
+			visit(entry.name, EntryType::Directory);
+		}
+	};
+	auto disableQueue = [&](){
+		workerQueue.usable = false;
+		statQueue = nullptr;
+	};
+	auto queryEntry = [&](const char* entryName, unsigned char type){
+		const PendingEntry entry = { entryName, type == DT_LNK, false };
+		if(statQueue == nullptr){
+			querySync(entry);
+			return;
+		}
+		pendingEntries.push_back(entry);
+		if(!statQueue->push(fd, entryName, entry.followLink ? 0 : AT_SYMLINK_NOFOLLOW, pendingEntries.size() - 1, onStatus)){
+			disableQueue();
+		}
+	};
+	// Names point in the listing buffer, they must be resolved before it is reused.
+	auto resolveEntries = [&](){
+		if(pendingEntries.empty()){
+			return;
+		}
+		bool drained = statQueue != nullptr && statQueue->drain(onStatus);
+		for(size_t i = 0; i < linkEntries.size() && drained; ++i){
+			drained = statQueue->push(fd, pendingEntries[linkEntries[i]].name, 0, linkEntries[i], onStatus);
+		}
+		drained = drained && statQueue->drain(onStatus);
+		linkEntries.clear();
+		if(!drained){
+			disableQueue();
+			for(const PendingEntry& entry : pendingEntries){
+				if(!entry.resolved){
+					querySync(entry);
+				}
+			}
+		}
+		pendingEntries.clear();
+	};
+#else
+	auto queryEntry = [&](const char* entryName, unsigned char type){
+		visit(entryName, queryNativeEntryType(fd, entryName, type));
+	};
+	auto resolveEntries = [](){};
+#endif
+
+	// Large buffer to list big directories in a few calls.
+	thread_local std::vector<char> buffer(1 << 20);
+	while(true){
+		resolveEntries();
+		const long readSize = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+		if(readSize < 0){
+			return listFailure(std::error_code(errno, std::generic_category()));
+		}
+		if(readSize == 0){
+			return ListStatus::Listed;
+		}
+		for(long offset = 0; offset < readSize;){
+			const LinuxDirent64* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+			offset += dirent->d_reclen;
+			const char* entryName = dirent->d_name;
+			if(entryName[0] == '.' && (entryName[1] == '\0' || (entryName[1] == '.' && entryName[2] == '\0'))){
+				continue;
+			}
+			if(dirent->d_type == DT_REG){
+				visit(entryName, EntryType::File);
+			} else if(dirent->d_type == DT_DIR){
+				visit(entryName, EntryType::Directory);
+			} else if(dirent->d_type == DT_UNKNOWN){
+				queryEntry(entryName, dirent->d_type);
+			} else if(dirent->d_type == DT_LNK && keepFile(std::string_view(entryName))){
+				// Only symlinks to files matter, don't query the ones that would be skipped anyway.
+				queryEntry(entryName, dirent->d_type);
+			}
+		}
+	}
+}
+
+void scanDirectoryNative(ScanState& state, std::shared_ptr<NativeDirectory> parent, std::string_view name, const std::string& relativePath, uint32_t parentId, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, unsigned int workerId);
+
+// Directory listed with getdents64, subdirectories being opened relative to it.
+struct NativeScanDirectory {
+	std::shared_ptr<NativeDirectory> directory;
+
+	fs::path path(const ScanSettings& settings) const {
+		return settings.inputDirPath / directory->relativePath;
+	}
+
+	int64_t modificationTime() const {
+		struct stat status;
+		if(fstat(directory->fd, &status) != 0){
+			return unknownTime;
+		}
+		return (int64_t)status.st_mtim.tv_sec * 1000000000ll + (int64_t)status.st_mtim.tv_nsec;
+	}
+
+	template<typename KeepFile, typename Visitor>
+	ListStatus list(KeepFile keepFile, Visitor visit) const {
+		return listNativeEntries(directory->fd, keepFile, visit);
+	}
+
+	void pushSubdirectory(ScanState& state, std::string_view entryName, std::string&& entryPath, uint32_t directoryId, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& ignoreRules, unsigned int workerId) const {
+		state.pool.push([&state, directory = directory, entryName, entryPath = std::move(entryPath), directoryId, mask, exclusionState, ignoreRules](unsigned int id){
+			scanDirectoryNative(state, directory, entryName, entryPath, directoryId, mask, exclusionState, ignoreRules, id);
+		}, workerId);
+	}
+};
+
+void scanDirectoryNative(ScanState& state, std::shared_ptr<NativeDirectory> parent, std::string_view name, const std::string& relativePath, uint32_t parentId, ProjectMask mask, uint32_t exclusionState, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, unsigned int workerId){
+	const uint32_t directoryId = state.addDirectory(parentId, name, workerId);
+	// Names are null-terminated in the arena. The root is reopened from its own descriptor.
+	const int fd = openat(parent->fd, parentId == noDirectoryId ? "." : name.data(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	// Release the parent as soon as possible to limit the number of open descriptors.
+	parent.reset();
+	if(fd < 0){
+		countListFailure(listFailure(std::error_code(errno, std::generic_category())), state.workerResults[workerId]);
+		return;
+	}
+	NativeScanDirectory directory = { std::make_shared<NativeDirectory>(fd, relativePath) };
+	scanListedDirectory(state, directory, relativePath, directoryId, mask, exclusionState, parentIgnoreRules, workerId);
+}
+
+#endif
+
+// Walk the input directory in parallel, each directory being a task on the pool.
+// Only the subtree at the given relative path is scanned if specified.
+bool scanInputDirectory(const ScanSettings& settings, unsigned int workerCount, ScanResults& results, const std::string& relativeRoot = std::string()){
+	const fs::path rootPath = relativeRoot.empty() ? settings.inputDirPath : (settings.inputDirPath / relativeRoot);
+	std::error_code error;
+	if(!fs::is_directory(rootPath, error)){
+		return false;
+	}
+	uint32_t rootExclusionState;
+	const ProjectMask rootMask = projectsAlongPath(settings, relativeRoot, rootExclusionState);
+	const std::shared_ptr<const IgnoreRules> rootIgnoreRules = ignoreRulesAbove(settings, relativeRoot);
+	if(!isScannedDirectory(settings, rootMask, relativeRoot)){
+		return true;
+	}
+	ScanState state(settings, workerCount);
+	const std::string_view rootName = state.workerResults[0].strings.append(relativeRoot);
+#ifdef VISUALGEN_NATIVE_SCAN
+	if(settings.nativeBackend){
+		// The root is opened relative to the current directory, following symlinks.
+		const int rootFd = open(rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(rootFd < 0){
+			return false;
+		}
+		std::shared_ptr<NativeDirectory> root = std::make_shared<NativeDirectory>(rootFd, relativeRoot);
+		state.pool.push([&state, root, rootName, &relativeRoot, rootMask, rootExclusionState, &rootIgnoreRules](unsigned int id){
+			scanDirectoryNative(state, root, rootName, relativeRoot, noDirectoryId, rootMask, rootExclusionState, rootIgnoreRules, id);
+		}, 0);
+		root.reset();
+	} else
+#endif
+	{
+		state.pool.push([&state, &rootPath, &relativeRoot, rootName, rootMask, rootExclusionState, &rootIgnoreRules](unsigned int id){
+			scanDirectory(state, rootPath, relativeRoot, noDirectoryId, rootName, rootMask, rootExclusionState, rootIgnoreRules, id);
+		}, 0);
+	}
+	state.pool.run();
+
+	for(ScanResults& workerResult : state.workerResults){
+		results.merge(workerResult);
+	}
+	results.directories.finalize();
+	return true;
+}
+
+// --------------------------------------------------------------------------------
+//	File lists
+// --------------------------------------------------------------------------------
+// Sources listing files instead of walking the disk. Their paths go through the same exclusion
+// and classification rules as scanned entries, and fill the same scan results.
+
+enum class InputSource {
+	Disk, GitIndex, List
+};
+
+class FileListBuilder {
+public:
+
+	// Listed paths are relative to the directory at the given prefix, separated by slashes.
+	FileListBuilder(const ScanSettings& aSettings, ScanResults& aResults, const std::string& aPrefix) : settings(aSettings), results(aResults), prefix(aPrefix) {
+		Directory root;
+		root.mask = projectsAlongPath(settings, std::string(), root.exclusionState);
+		root.id = 0;
+		results.directories.add(root.id, noDirectoryId, results.strings.append(std::string_view()));
+		directoryCount = 1;
+		directories.emplace(std::string_view(), root);
+	}
+
+	void addFile(std::string_view path){
+		if(!prefix.empty()){
+			if(path.size() <= prefix.size() || path.compare(0, prefix.size(), prefix) != 0 || !isSeparator(path[prefix.size()])){
+				return;
+			}
+			path.remove_prefix(prefix.size() + 1);
+		}
+		size_t separator = path.size();
+		while(separator > 0 && !isSeparator(path[separator - 1])){
+			--separator;
+		}
+		const std::string_view name = path.substr(separator);
+		if(name.empty()){
+			return;
+		}
+		const Directory& directory = findDirectory(separator == 0 ? std::string_view() : path.substr(0, separator - 1));
+		if(directory.id == noDirectoryId){
+			return;
+		}
+		ProjectMask compileMask;
+		ProjectMask includeMask;
+		classifyFilename(settings, directory.mask, directory.exclusionState, name, compileMask, includeMask);
+		if((compileMask | includeMask) != 0){
+			results.files.push_back({ directory.id, results.strings.append(name), compileMask, includeMask });
+		}
+	}
+
+	// Once all files have been added.
+	void finish(){
+		results.directories.finalize();
+	}
+
+private:
+
+	// Directories that are not scanned have no id.
+	struct Directory {
+		uint32_t id = noDirectoryId;
+		ProjectMask mask = 0;
+		uint32_t exclusionState = ExclusionMatcher::deadState;
+	};
+
+	static bool isSeparator(char c){
+		return c == '/' || c == (char)fs::path::preferred_separator;
+	}
+
+	// Lists are usually grouped by directory, the last one is checked first.
+	const Directory& findDirectory(std::string_view dirPath){
+		if(lastDirectory != nullptr && dirPath == lastPath){
+			return *lastDirectory;
+		}
+		auto directory = directories.find(dirPath);
+		if(directory == directories.end()){
+			size_t separator = dirPath.size();
+			while(separator > 0 && !isSeparator(dirPath[separator - 1])){
+				--separator;
+			}
+			// References to elements are stable in the map.
+			const Directory& parent = findDirectory(separator == 0 ? std::string_view() : dirPath.substr(0, separator - 1));
+			Directory newDirectory;
+			const std::string_view name = dirPath.substr(separator);
+			if(parent.id != noDirectoryId && !name.empty()){
+				std::string entryPath(dirPath);
+				std::replace(entryPath.begin(), entryPath.end(), '/', (char)fs::path::preferred_separator);
+				if(isPrunedDirectory(settings, name, entryPath)){
+					++results.prunedDirCount;
+					directory = directories.emplace(results.strings.append(dirPath), newDirectory).first;
+					lastPath = directory->first;
+					lastDirectory = &directory->second;
+					return directory->second;
+				}
+				newDirectory.mask = subdirectoryProjects(settings, parent.mask, parent.exclusionState, entryPath, newDirectory.exclusionState);
+				if(isScannedDirectory(settings, newDirectory.mask, entryPath)){
+					newDirectory.id = directoryCount++;
+					results.directories.add(newDirectory.id, parent.id, results.strings.append(name));
+				}
+			}
+			directory = directories.emplace(results.strings.append(dirPath), newDirectory).first;
+		}
+		lastPath = directory->first;
+		lastDirectory = &directory->second;
+		return directory->second;
+	}
+
+	const ScanSettings& settings;
+	ScanResults& results;
+	const std::string prefix;
+	std::unordered_map<std::string_view, Directory> directories;
+	uint32_t directoryCount = 0;
+	std::string_view lastPath;
+	const Directory* lastDirectory = nullptr;
+};
+
+// Git directory of the repository containing a directory, and the path of that directory in the worktree.
+bool findGitRepository(const fs::path& dirPath, fs::path& worktreePath, fs::path& gitDirPath, std::string& prefix){
+	std::error_code error;
+	fs::path currentPath = fs::weakly_canonical(fs::absolute(dirPath, error), error);
+	if(error){
+		return false;
+	}
+	std::vector<std::string> components;
+	while(true){
+		const fs::path dotGitPath = currentPath / ".git";
+		if(fs::is_directory(dotGitPath, error)){
+			gitDirPath = dotGitPath;
+			break;
+		}
+		// Worktrees and submodules point to their git directory.
+		if(fs::is_regular_file(dotGitPath, error)){
+			std::ifstream dotGitFile(dotGitPath);
+			std::string line;
+			std::getline(dotGitFile, line);
+			line = trim(line, " \r");
+			if(line.compare(0, 8, "gitdir: ") != 0){
+				return false;
+			}
+			gitDirPath = currentPath / fs::path(line.substr(8));
+			break;
+		}
+		if(!currentPath.has_relative_path()){
+			return false;
+		}
+		components.push_back(currentPath.filename().string());
+		currentPath = currentPath.parent_path();
+	}
+	worktreePath = currentPath;
+	prefix.clear();
+	for(auto component = components.rbegin(); component != components.rend(); ++component){
+		if(!prefix.empty()){
+			prefix.push_back('/');
+		}
+		prefix.append(*component);
+	}
+	return true;
+}
+
+// Size of object hashes, repositories using SHA-256 declaring it in their configuration.
+size_t gitHashSize(const fs::path& gitDirPath){
+	std::ifstream config(gitDirPath / "config");
+	std::string line;
+	while(std::getline(config, line)){
+		std::transform(line.begin(), line.end(), line.begin(), [](unsigned char c){ return (char)std::tolower(c); });
+		if(line.find("objectformat") != std::string::npos && line.find("sha256") != std::string::npos){
+			return 32;
+		}
+	}
+	return 20;
+}
+
+// Index entry as read from the file, before the entries of a split index are merged.
+struct GitIndexEntry {
+	std::string path;
+	uint32_t mode;
+	uint32_t flags;
+	uint32_t extendedFlags;
+};
+
+uint32_t readBigEndian(const unsigned char* data, size_t byteCount){
+	uint32_t value = 0;
+	for(size_t i = 0; i < byteCount; ++i){
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+// Visit the entries of an index file, versions 2 to 4, read in place from the mapped file:
+// visitor(path, mode, flags, extendedFlags). Version 4 paths are rebuilt from the previous one.
+// The offset of the extensions is returned, or zero if the index is invalid.
+template<typename Visitor>
+size_t visitGitIndexEntries(const MappedFile& index, size_t hashSize, Visitor&& visitor){
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(index.data());
+	const size_t size = index.size();
+	if(size < 12 || std::memcmp(data, "DIRC", 4) != 0){
+		return 0;
+	}
+	const uint32_t version = readBigEndian(data + 4, 4);
+	if(version < 2 || version > 4){
+		return 0;
+	}
+	const uint32_t entryCount = readBigEndian(data + 8, 4);
+	// Stat data, hash and flags.
+	const size_t fixedSize = 40 + hashSize + 2;
+
+	std::string path;
+	size_t offset = 12;
+	for(uint32_t i = 0; i < entryCount; ++i){
+		const size_t entryStart = offset;
+		if(offset + fixedSize > size){
+			return 0;
+		}
+		const uint32_t mode = readBigEndian(data + offset + 24, 4);
+		const uint32_t flags = readBigEndian(data + offset + fixedSize - 2, 2);
+		offset += fixedSize;
+		uint32_t extendedFlags = 0;
+		if(flags & 0x4000){
+			if(version < 3 || offset + 2 > size){
+				return 0;
+			}
+			extendedFlags = readBigEndian(data + offset, 2);
+			offset += 2;
+		}
+		if(version == 4){
+			// Number of bytes to remove from the previous path, as an offset varint.
+			if(offset >= size){
+				return 0;
+			}
+			size_t removedSize = data[offset] & 0x7f;
+			while(data[offset++] & 0x80){
+				if(offset >= size){
+					return 0;
+				}
+				removedSize = ((removedSize + 1) << 7) | (data[offset] & 0x7f);
+			}
+			if(removedSize > path.size()){
+				return 0;
+			}
+			path.resize(path.size() - removedSize);
+		} else {
+			path.clear();
+		}
+		const char* suffix = index.data() + offset;
+		const char* suffixEnd = static_cast<const char*>(std::memchr(suffix, '\0', size - offset));
+		if(suffixEnd == nullptr){
+			return 0;
+		}
+		path.append(suffix, suffixEnd);
+		offset = (size_t)(suffixEnd - index.data()) + 1;
+		if(version != 4){
+			// Entries are padded with one to eight null bytes.
+			offset = entryStart + (((size_t)(suffixEnd - index.data()) - entryStart + 8) & ~size_t(7));
+		}
+		visitor(path, mode, flags, extendedFlags);
+	}
+	return offset;
+}
+
+// Content of an extension of the index, empty if absent.
+std::string_view findGitIndexExtension(const MappedFile& index, size_t extensionsOffset, size_t hashSize, const char* signature){
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(index.data());
+	// The index ends with its own hash.
+	const size_t end = index.size() >= hashSize ? index.size() - hashSize : 0;
+	size_t offset = extensionsOffset;
+	while(offset + 8 <= end){
+		const size_t extensionSize = readBigEndian(data + offset + 4, 4);
+		if(extensionSize > end - offset - 8){
+			break;
+		}
+		if(std::memcmp(data + offset, signature, 4) == 0){
+			return std::string_view(index.data() + offset + 8, extensionSize);
+		}
+		offset += 8 + extensionSize;
+	}
+	return std::string_view();
+}
+
+// Visit the set bits of an EWAH compressed bitmap as serialized by git: the bit count, the
+// word count, the 64-bit words and the position of the last marker word. Each marker word
+// gives a run of identical words, then a number of literal words. The view is advanced past
+// the bitmap, false is returned if it is truncated or a bit is past the bit count.
+template<typename Visitor>
+bool visitEwahBits(std::string_view& bitmap, Visitor&& visitor){
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(bitmap.data());
+	if(bitmap.size() < 8){
+		return false;
+	}
+	const uint64_t bitCount = readBigEndian(data, 4);
+	const size_t wordCount = readBigEndian(data + 4, 4);
+	if(bitmap.size() < 12 || (bitmap.size() - 12) / 8 < wordCount){
+		return false;
+	}
+	auto readWord = [data](size_t wordIndex){
+		const unsigned char* word = data + 8 + 8 * wordIndex;
+		return ((uint64_t)readBigEndian(word, 4) << 32) | readBigEndian(word + 4, 4);
+	};
+	uint64_t position = 0;
+	for(size_t i = 0; i < wordCount;){
+		const uint64_t marker = readWord(i++);
+		const uint64_t runLength = 64 * ((marker >> 1) & 0xffffffffu);
+		const size_t literalCount = (size_t)(marker >> 33);
+		if(marker & 1u){
+			for(uint64_t bit = position; bit < position + runLength && bit < bitCount; ++bit){
+				visitor((size_t)bit);
+			}
+		}
+		position += runLength;
+		if(literalCount > wordCount - i){
+			return false;
+		}
+		for(size_t literal = 0; literal < literalCount; ++literal, position += 64){
+			const uint64_t word = readWord(i++);
+			for(unsigned int bit = 0; bit < 64; ++bit){
+				if((word >> bit) & 1u){
+					if(position + bit >= bitCount){
+						return false;
+					}
+					visitor((size_t)(position + bit));
+				}
+			}
+		}
+	}
+	bitmap.remove_prefix(12 + 8 * wordCount);
+	return true;
+}
+
+// Entries of a split index: the shared index holds most of them, the index lists the entries
+// replacing shared ones, with an empty path, then the added ones. The link extension names the
+// shared index and marks the deleted and replaced shared entries in two bitmaps.
+bool readSplitGitIndex(const MappedFile& index, const fs::path& gitDirPath, size_t hashSize, std::string_view link, std::vector<GitIndexEntry>& entries){
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string sharedName = "sharedindex.";
+	for(size_t i = 0; i < hashSize; ++i){
+		const unsigned char byte = (unsigned char)link[i];
+		sharedName.push_back(hexDigits[byte >> 4]);
+		sharedName.push_back(hexDigits[byte & 15]);
+	}
+	MappedFile sharedIndex;
+	if(!sharedIndex.open(gitDirPath / sharedName)){
+		return false;
+	}
+	auto collect = [](std::vector<GitIndexEntry>& collected){
+		return [&collected](const std::string& path, uint32_t mode, uint32_t flags, uint32_t extendedFlags){
+			collected.push_back({ path, mode, flags, extendedFlags });
+		};
+	};
+	if(visitGitIndexEntries(sharedIndex, hashSize, collect(entries)) == 0){
+		return false;
+	}
+	std::vector<GitIndexEntry> splitEntries;
+	visitGitIndexEntries(index, hashSize, collect(splitEntries));
+
+	std::vector<bool> deleted(entries.size(), false);
+	size_t replacedCount = 0;
+	bool valid = true;
+	std::string_view bitmaps = link.substr(hashSize);
+	if(!bitmaps.empty()){
+		valid = visitEwahBits(bitmaps, [&](size_t position){
+			valid = valid && position < entries.size();
+			if(valid){
+				deleted[position] = true;
+			}
+		}) && valid;
+		valid = valid && visitEwahBits(bitmaps, [&](size_t position){
+			valid = valid && position < entries.size() && replacedCount < splitEntries.size() && splitEntries[replacedCount].path.empty();
+			if(valid){
+				GitIndexEntry& replacement = splitEntries[replacedCount++];
+				replacement.path = std::move(entries[position].path);
+				entries[position] = std::move(replacement);
+				deleted[position] = false;
+			}
+		}) && valid;
+	}
+	if(!valid){
+		return false;
+	}
+	// Entries are compacted in place, never moved onto themselves.
+	size_t keptCount = 0;
+	for(size_t i = 0; i < entries.size(); ++i){
+		if(!deleted[i]){
+			if(keptCount != i){
+				entries[keptCount] = std::move(entries[i]);
+			}
+			++keptCount;
+		}
+	}
+	entries.resize(keptCount);
+	// Added entries replace shared ones with the same path and stage.
+	entries.insert(entries.end(), std::make_move_iterator(splitEntries.begin() + replacedCount), std::make_move_iterator(splitEntries.end()));
+	std::stable_sort(entries.begin(), entries.end(), [](const GitIndexEntry& entryA, const GitIndexEntry& entryB){
+		return entryA.path < entryB.path;
+	});
+	auto stage = [](const GitIndexEntry& entry){
+		return (entry.flags >> 12) & 3;
+	};
+	keptCount = 0;
+	for(size_t i = 0; i < entries.size(); ++i){
+		if(i + 1 < entries.size() && entries[i + 1].path == entries[i].path && stage(entries[i + 1]) == stage(entries[i])){
+			continue;
+		}
+		if(keptCount != i){
+			entries[keptCount] = std::move(entries[i]);
+		}
+		++keptCount;
+	}
+	entries.resize(keptCount);
+	return true;
+}
+
+// Files tracked in the git index, split or not. Submodules, sparse directories,
+// files outside the sparse checkout and symlinks to non-files are skipped.
+bool readGitIndex(const fs::path& worktreePath, const fs::path& gitDirPath, FileListBuilder& builder){
+	MappedFile index;
+	if(!index.open(gitDirPath / "index")){
+		return false;
+	}
+	const size_t hashSize = gitHashSize(gitDirPath);
+	std::string conflictPath;
+	auto addEntry = [&](const std::string& path, uint32_t mode, uint32_t flags, uint32_t extendedFlags){
+		const uint32_t type = mode & 0170000;
+		const bool skipWorktree = (extendedFlags & 0x4000) != 0;
+		if((type != 0100000 && type != 0120000) || skipWorktree){
+			return;
+		}
+		// Conflicting entries list the same path for each stage.
+		if(((flags >> 12) & 3) != 0){
+			if(path == conflictPath){
+				return;
+			}
+			conflictPath = path;
+		}
+		std::error_code error;
+		if(type == 0120000 && !fs::is_regular_file(worktreePath / path, error)){
+			return;
+		}
+		builder.addFile(path);
+	};
+	// Extensions follow the entries, they are located with a first pass.
+	const size_t extensionsOffset = visitGitIndexEntries(index, hashSize, [](const std::string&, uint32_t, uint32_t, uint32_t){});
+	if(extensionsOffset == 0){
+		return false;
+	}
+	const std::string_view link = findGitIndexExtension(index, extensionsOffset, hashSize, "link");
+	// A null shared index hash means that the index isn't split anymore.
+	const bool split = link.size() >= hashSize && link.substr(0, hashSize).find_first_not_of('\0') != std::string_view::npos;
+	if(!split){
+		visitGitIndexEntries(index, hashSize, addEntry);
+		return true;
+	}
+	std::vector<GitIndexEntry> entries;
+	if(!readSplitGitIndex(index, gitDirPath, hashSize, link, entries)){
+		std::cout << "Unable to read the shared index of the split index in " << gitDirPath.string() << std::endl;
+		return false;
+	}
+	for(const GitIndexEntry& entry : entries){
+		addEntry(entry.path, entry.mode, entry.flags, entry.extendedFlags);
+	}
+	return true;
+}
+
+// Fill the scan results from the index of the repository containing the scanned directory.
+bool listGitIndexFiles(const ScanSettings& settings, ScanResults& results){
+	fs::path worktreePath;
+	fs::path gitDirPath;
+	std::string prefix;
+	if(!findGitRepository(settings.inputDirPath, worktreePath, gitDirPath, prefix)){
+		return false;
+	}
+	FileListBuilder builder(settings, results, prefix);
+	if(!readGitIndex(worktreePath, gitDirPath, builder)){
+		return false;
+	}
+	builder.finish();
+	return true;
+}
+
+// Paths read at once from a file or the standard input, separated by null characters if
+// there are any, else by line breaks. Paths are visited in place in the buffer.
+class FileList {
+public:
+
+	// The standard input is read if the path is empty or '-'.
+	bool load(const std::string& path){
+		if(!path.empty() && path != "-"){
+			if(!file.open(path)){
+				return false;
+			}
+			content = std::string_view(file.data(), file.size());
+			return true;
+		}
+		std::vector<char> chunk(1 << 20);
+		while(true){
+			const size_t readSize = std::fread(chunk.data(), 1, chunk.size(), stdin);
+			buffer.append(chunk.data(), readSize);
+			if(readSize < chunk.size()){
+				break;
+			}
+		}
+		content = buffer;
+		return std::ferror(stdin) == 0;
+	}
+
+	template<typename Visitor>
+	void visit(Visitor&& visitor) const {
+		const char separator = content.find('\0') != std::string_view::npos ? '\0' : '\n';
+		for(size_t start = 0; start < content.size();){
+			size_t end = content.find(separator, start);
+			if(end == std::string_view::npos){
+				end = content.size();
+			}
+			std::string_view path = content.substr(start, end - start);
+			start = end + 1;
+			if(!path.empty() && path.back() == '\r'){
+				path.remove_suffix(1);
+			}
+			while(path.size() > 2 && path[0] == '.' && path[1] == '/'){
+				path.remove_prefix(2);
+			}
+			if(!path.empty()){
+				visitor(path);
+			}
+		}
+	}
+
+private:
+
+	MappedFile file;
+	std::string buffer;
+	std::string_view content;
+};
+
+// Fill the scan results from a list of paths relative to the current directory.
+bool listFiles(const ScanSettings& settings, const FileList& list, ScanResults& results){
+	std::error_code error;
+	const fs::path currentPath = fs::current_path(error);
+	const fs::path relativePath = fs::absolute(settings.inputDirPath, error).lexically_normal().lexically_relative(currentPath);
+	std::string prefix = relativePath.generic_string();
+	if(error || relativePath.empty() || prefix.compare(0, 2, "..") == 0){
+		return false;
+	}
+	while(!prefix.empty() && prefix.back() == '/'){
+		prefix.pop_back();
+	}
+	if(prefix == "."){
+		prefix.clear();
+	}
+	FileListBuilder builder(settings, results, prefix);
+	list.visit([&builder](std::string_view path){
+		builder.addFile(path);
+	});
+	builder.finish();
+	return true;
+}
+
+// --------------------------------------------------------------------------------
+//	XML scanning
+// --------------------------------------------------------------------------------
+// Minimal SAX-style tokenizer over a buffer, enough to locate the elements of project files
+// and copy the bytes around them. Entities are not decoded and the document isn't validated.
+
+enum class XmlTokenType {
+	Text, StartTag, EndTag, EmptyTag, Comment, CData, Declaration
+};
+
+struct XmlToken {
+	XmlTokenType type;
+	// Range of the whole token in the buffer.
+	size_t begin;
+	size_t end;
+	// For tags, their name and the raw text of their attributes.
+	std::string_view name;
+	std::string_view attributes;
+};
+
+class XmlScanner {
+public:
+
+	explicit XmlScanner(std::string_view aContent) : content(aContent) {}
+
+	// Returns false at the end of the buffer, or on an unterminated markup.
+	bool next(XmlToken& token){
+		if(position >= content.size()){
+			return false;
+		}
+		token.begin = position;
+		token.name = std::string_view();
+		token.attributes = std::string_view();
+		if(content[position] != '<'){
+			token.type = XmlTokenType::Text;
+			position = std::min(content.find('<', position), content.size());
+			token.end = position;
+			return true;
+		}
+		if(startsWith("<!--")){
+			token.type = XmlTokenType::Comment;
+			return skipPast("-->", token);
+		}
+		if(startsWith("<![CDATA[")){
+			token.type = XmlTokenType::CData;
+			return skipPast("]]>", token);
+		}
+		if(startsWith("<?")){
+			token.type = XmlTokenType::Declaration;
+			return skipPast("?>", token);
+		}
+		if(startsWith("<!")){
+			// Doctype, possibly with an internal subset in brackets.
+			token.type = XmlTokenType::Declaration;
+			size_t depth = 0;
+			for(size_t i = position + 2; i < content.size(); ++i){
+				depth += content[i] == '[' ? 1 : 0;
+				depth -= (content[i] == ']' && depth != 0) ? 1 : 0;
+				if(content[i] == '>' && depth == 0){
+					position = i + 1;
+					token.end = position;
+					return true;
+				}
+			}
+			return false;
+		}
+		const bool closing = startsWith("</");
+		const size_t nameBegin = position + (closing ? 2 : 1);
+		size_t nameEnd = nameBegin;
+		while(nameEnd < content.size() && !isNameEnd(content[nameEnd])){
+			++nameEnd;
+		}
+		token.name = content.substr(nameBegin, nameEnd - nameBegin);
+		// Attribute values can contain '>'.
+		char quote = '\0';
+		for(size_t i = nameEnd; i < content.size(); ++i){
+			const char c = content[i];
+			if(quote != '\0'){
+				quote = c == quote ? '\0' : quote;
+			} else if(c == '"' || c == '\''){
+				quote = c;
+			} else if(c == '>'){
+				const bool empty = !closing && content[i - 1] == '/';
+				token.type = closing ? XmlTokenType::EndTag : (empty ? XmlTokenType::EmptyTag : XmlTokenType::StartTag);
+				token.attributes = content.substr(nameEnd, i - nameEnd - (empty ? 1 : 0));
+				position = i + 1;
+				token.end = position;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Value of an attribute, without its quotes.
+	static bool findAttribute(std::string_view attributes, std::string_view name, std::string_view& value){
+		size_t i = 0;
+		while(i < attributes.size()){
+			while(i < attributes.size() && isSpace(attributes[i])){
+				++i;
+			}
+			const size_t nameBegin = i;
+			while(i < attributes.size() && attributes[i] != '=' && !isSpace(attributes[i])){
+				++i;
+			}
+			const std::string_view attributeName = attributes.substr(nameBegin, i - nameBegin);
+			while(i < attributes.size() && (isSpace(attributes[i]) || attributes[i] == '=')){
+				++i;
+			}
+			if(i >= attributes.size() || (attributes[i] != '"' && attributes[i] != '\'')){
+				return false;
+			}
+			const size_t valueEnd = attributes.find(attributes[i], i + 1);
+			if(valueEnd == std::string_view::npos){
+				return false;
+			}
+			if(attributeName == name){
+				value = attributes.substr(i + 1, valueEnd - i - 1);
+				return true;
+			}
+			i = valueEnd + 1;
+		}
+		return false;
+	}
+
+	static bool isSpace(char c){
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+private:
+
+	bool startsWith(std::string_view prefix) const {
+		return content.compare(position, prefix.size(), prefix) == 0;
+	}
+
+	bool skipPast(std::string_view terminator, XmlToken& token){
+		const size_t terminatorPos = content.find(terminator, position);
+		if(terminatorPos == std::string_view::npos){
+			return false;
+		}
+		position = terminatorPos + terminator.size();
+		token.end = position;
+		return true;
+	}
+
+	static bool isNameEnd(char c){
+		return isSpace(c) || c == '>' || c == '/';
+	}
+
+	std::string_view content;
+	size_t position = 0;
+};
+
+// Text content of the first child element with a given name.
+bool findChildText(std::string_view element, std::string_view name, std::string_view& text){
+	XmlScanner scanner(element);
+	XmlToken token;
+	bool inChild = false;
+	while(scanner.next(token)){
+		if(inChild){
+			text = token.type == XmlTokenType::Text ? element.substr(token.begin, token.end - token.begin) : std::string_view();
+			return true;
+		}
+		if(token.name == name && token.type == XmlTokenType::EmptyTag){
+			text = std::string_view();
+			return true;
+		}
+		// Skip the element itself.
+		inChild = token.begin != 0 && token.name == name && token.type == XmlTokenType::StartTag;
+	}
+	return false;
+}
+
+// --------------------------------------------------------------------------------
+//	Project template
+// --------------------------------------------------------------------------------
+
+// Header and footer surrounding the generated ItemGroups, taken from the existing project if any.
+// They are ranges of the mapped project, appended as is to the output.
+class VcxprojTemplate {
+public:
+
+	void load(const fs::path& projectPath, const std::string& projectName){
+		header.clear();
+		footer.clear();
+		ownedText.clear();
+		document = std::string_view();
+		groups.clear();
+		items.clear();
+		depth = 0;
+		projectEnd = std::string_view::npos;
+		// Open existing .vcxproj
+		if(!file.open(projectPath)){
+			ownedText.emplace_back("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<Project DefaultTargets=\"Build\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n\n");
+			ownedText.emplace_back("\n<PropertyGroup Label=\"Globals\">\n\t<RootNamespace>" + projectName + "</RootNamespace>\n</PropertyGroup>\n\n</Project>\n");
+			header.emplace_back(ownedText.front());
+			footer.emplace_back(ownedText.back());
+			return;
+		}
+		std::string_view content(file.data(), file.size());
+		// The project used to be read as text lines, each ending with a newline.
+#ifdef _WIN32
+		ownedText.emplace_back(content);
+		replace(ownedText.back(), "\r\n", "\n");
+		content = ownedText.back();
+#endif
+		const bool missingNewline = !content.empty() && content.back() != '\n';
+		document = content;
+
+		// Plain ItemGroups are replaced, the ones with attributes (configurations...) are kept.
+		std::vector<std::pair<size_t, size_t>> groupRanges;
+		XmlScanner scanner(content);
+		XmlToken token;
+		size_t groupStart = std::string_view::npos;
+		while(scanner.next(token)){
+			recordElement(token);
+			if(token.name != "ItemGroup"){
+				continue;
+			}
+			if(token.type == XmlTokenType::StartTag && groupStart == std::string_view::npos && isBlank(token.attributes)){
+				groupStart = token.begin;
+			} else if(token.type == XmlTokenType::EndTag && groupStart != std::string_view::npos){
+				groupRanges.emplace_back(groupStart, token.end);
+				groupStart = std::string_view::npos;
+			}
+		}
+		// Unterminated group, left untouched.
+		if(!groups.empty() && groups.back().end == 0){
+			items.resize(groups.back().firstItem);
+			groups.pop_back();
+		}
+		// If no group found, artificially insert one just before the end
+		if(groupRanges.empty() && projectEnd != std::string_view::npos && projectEnd > 0){
+			groupRanges.emplace_back(projectEnd, projectEnd);
+		}
+
+		if(groupRanges.empty()){
+			// If groups still empty, probably malformed, attempt to save face.
+			header.emplace_back(content);
+			if(missingNewline){
+				header.emplace_back("\n");
+			}
+			footer.emplace_back("\n</Project>");
+			return;
+		}
+		header.emplace_back(content.substr(0, groupRanges[0].first));
+		for(size_t i = 1; i < groupRanges.size(); ++i){
+			const std::string_view gap = content.substr(groupRanges[i - 1].second, groupRanges[i].first - groupRanges[i - 1].second);
+			// Skip empty lines.
+			if(!isBlank(gap)){
+				footer.emplace_back(gap);
+			}
+		}
+		footer.emplace_back(content.substr(groupRanges.back().second));
+		if(missingNewline){
+			footer.emplace_back("\n");
+		}
+	}
+
+	template<typename Output>
+	void appendHeader(Output& output) const {
+		for(const std::string_view range : header){
+			output.appendView(range);
+		}
+	}
+
+	template<typename Output>
+	void appendFooter(Output& output) const {
+		for(const std::string_view range : footer){
+			output.appendView(range);
+		}
+	}
+
+	// Elements of the top-level ItemGroups, for in-place updates.
+	struct Item {
+		std::string_view type;
+		std::string_view path;
+		// The whitespace preceding the element belongs to it.
+		size_t leadBegin;
+		size_t begin;
+		size_t end;
+	};
+
+	struct Group {
+		size_t begin;
+		size_t contentBegin;
+		size_t contentEnd = 0;
+		size_t end = 0;
+		size_t firstItem;
+		size_t itemCount = 0;
+		bool plain;
+	};
+
+	// Empty if there was no existing project.
+	std::string_view content() const {
+		return document;
+	}
+
+	const std::vector<Group>& itemGroups() const {
+		return groups;
+	}
+
+	const std::vector<Item>& groupItems() const {
+		return items;
+	}
+
+	// Whether items can be placed in the existing project.
+	bool updatable() const {
+		return !groups.empty() || projectEnd != std::string_view::npos;
+	}
+
+	// Offset of the first closing Project tag, npos if none.
+	size_t projectEndOffset() const {
+		return projectEnd;
+	}
+
+private:
+
+	static bool isBlank(std::string_view text){
+		return std::all_of(text.begin(), text.end(), XmlScanner::isSpace);
+	}
+
+	// Track the elements nested in top-level ItemGroups.
+	void recordElement(const XmlToken& token){
+		const bool inGroup = !groups.empty() && groups.back().end == 0;
+		switch(token.type){
+			case XmlTokenType::StartTag:
+				if(depth == 1 && token.name == "ItemGroup"){
+					groups.push_back({ token.begin, token.end, 0, 0, items.size(), 0, isBlank(token.attributes) });
+				} else if(depth == 2 && inGroup){
+					addItem(token);
+				}
+				++depth;
+				break;
+			case XmlTokenType::EmptyTag:
+				if(depth == 2 && inGroup){
+					addItem(token);
+					items.back().end = token.end;
+				}
+				break;
+			case XmlTokenType::EndTag:
+				depth -= depth != 0 ? 1 : 0;
+				if(depth == 2 && inGroup && !items.empty() && items.back().end == 0){
+					items.back().end = token.end;
+				} else if(depth == 1 && inGroup && token.name == "ItemGroup"){
+					Group& group = groups.back();
+					group.contentEnd = token.begin;
+					group.end = token.end;
+					group.itemCount = items.size() - group.firstItem;
+				} else if(token.name == "Project" && projectEnd == std::string_view::npos){
+					projectEnd = token.begin;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	void addItem(const XmlToken& token){
+		std::string_view path;
+		XmlScanner::findAttribute(token.attributes, "Include", path);
+		size_t leadBegin = token.begin;
+		while(leadBegin > 0 && XmlScanner::isSpace(document[leadBegin - 1])){
+			--leadBegin;
+		}
+		items.push_back({ token.name, path, leadBegin, token.begin, 0 });
+	}
+
+	MappedFile file;
+	// Text that isn't in the file, in a deque to keep views stable.
+	std::deque<std::string> ownedText;
+	std::vector<std::string_view> header;
+	std::vector<std::string_view> footer;
+	std::string_view document;
+	std::vector<Group> groups;
+	std::vector<Item> items;
+	size_t depth = 0;
+	size_t projectEnd = std::string_view::npos;
+};
+
+// --------------------------------------------------------------------------------
+//	Project generation
+// --------------------------------------------------------------------------------
+
+struct ProjectItem {
+	std::string_view path;
+	// Filter of the parent directory, empty at the root.
+	std::string_view filter;
+};
+
+// Items of one project, sorted, with paths relative to its input directory.
+// Paths are stored in the items arena, filters are owned by the scan results.
+struct ProjectItems {
+	StringArena strings;
+	std::vector<ProjectItem> compileItems;
+	std::vector<ProjectItem> includeItems;
+	std::vector<std::string_view> filterPaths;
+};
+
+// Projects with files below each directory. Only these directories are materialized.
+std::vector<ProjectMask> collectDirectoryProjects(ScanResults& results){
+	DirectoryTable& directories = results.directories;
+	std::vector<ProjectMask> directoryMasks(directories.size(), 0);
+	for(const ScannedFile& file : results.files){
+		directoryMasks[file.directoryId] |= file.compileMask | file.includeMask;
+	}
+	// Children always come after their parent.
+	for(size_t id = directoryMasks.size(); id-- > 1;){
+		directoryMasks[directories.parent((uint32_t)id)] |= directoryMasks[id];
+	}
+	for(size_t id = 0; id < directoryMasks.size(); ++id){
+		if(directoryMasks[id] != 0){
+			directories.materialize((uint32_t)id, results.strings);
+		}
+	}
+	return directoryMasks;
+}
+
+void collectProjectItems(const ScanSettings& settings, const ScanResults& results, const std::vector<ProjectMask>& directoryMasks, size_t projectIndex, unsigned int workerCount, ProjectItems& items){
+	const ProjectMask projectBit = ProjectMask(1) << projectIndex;
+	const DirectoryTable& directories = results.directories;
+	// Strip the project input directory from paths and filters.
+	const std::string& rootPath = settings.projects[projectIndex].rootPath;
+	const size_t rootLength = rootPath.empty() ? 0 : (rootPath.size() + 1);
+
+	for(const ScannedFile& file : results.files){
+		if(((file.compileMask | file.includeMask) & projectBit) == 0){
+			continue;
+		}
+		const std::string_view dirPath = directories.path(file.directoryId).substr(std::min(rootLength, directories.path(file.directoryId).size()));
+		const std::string_view filter = directories.filter(file.directoryId).substr(std::min(rootLength, directories.filter(file.directoryId).size()));
+		const ProjectItem item = { items.strings.append(dirPath, (char)fs::path::preferred_separator, file.name), filter };
+		if(file.compileMask & projectBit){
+			items.compileItems.push_back(item);
+		}
+		if(file.includeMask & projectBit){
+			items.includeItems.push_back(item);
+		}
+	}
+	// Directories below the project input directory containing some of its files.
+	for(size_t id = 0; id < directoryMasks.size(); ++id){
+		if((directoryMasks[id] & projectBit) && directories.path((uint32_t)id).size() > rootPath.size()){
+			items.filterPaths.emplace_back(directories.filter((uint32_t)id).substr(rootLength));
+		}
+	}
+
+	// Sort filters from smallest to largest, that way a parent is always before its children.
+	// Items follow the fs::path order, where a parent directory content comes before its siblings.
+	auto itemPath = [](const ProjectItem& item){
+		return item.path;
+	};
+	sortStrings<false>(items.filterPaths, [](std::string_view filter){ return filter; }, workerCount);
+	sortStrings<true>(items.compileItems, itemPath, workerCount);
+	sortStrings<true>(items.includeItems, itemPath, workerCount);
+}
+
+// Outputs are assembled from parts concatenated in order. Item groups are split in chunks
+// of items formatted on the task pool, each in its own buffer reserved from the path lengths.
+class ChunkedOutput {
+public:
+
+	void appendText(std::string text){
+		parts.emplace_back().text = std::move(text);
+	}
+
+	// The viewed text must outlive the concatenation.
+	void appendView(std::string_view view){
+		parts.emplace_back().view = view;
+	}
+
+	// Items must outlive the pool run.
+	template<typename T, typename Estimator, typename Formatter>
+	void appendItems(TaskPool& pool, const std::vector<T>& items, Estimator estimate, Formatter format){
+		for(size_t begin = 0; begin < items.size(); begin += outputChunkSize){
+			const size_t end = std::min(items.size(), begin + outputChunkSize);
+			// References to deque elements stay valid when appending.
+			std::string& part = parts.emplace_back().text;
+			pool.push([&part, &items, begin, end, estimate, format](unsigned int){
+				size_t capacity = 0;
+				for(size_t i = begin; i < end; ++i){
+					capacity += estimate(items[i]);
+				}
+				part.reserve(capacity);
+				for(size_t i = begin; i < end; ++i){
+					format(part, items[i]);
+				}
+			}, 0);
+		}
+	}
+
+	// Once the pool has run. Parts are released as they are copied.
+	std::string concatenate(){
+		size_t size = 0;
+		for(const Part& part : parts){
+			size += part.contents().size();
+		}
+		std::string content;
+		content.reserve(size);
+		for(Part& part : parts){
+			content.append(part.contents());
+			std::string().swap(part.text);
+		}
+		parts.clear();
+		return content;
+	}
+
+private:
+
+	static constexpr size_t outputChunkSize = 4096;
+
+	struct Part {
+		std::string text;
+		std::string_view view;
+
+		std::string_view contents() const {
+			return view.data() != nullptr ? view : std::string_view(text);
+		}
+	};
+
+	std::deque<Part> parts;
+};
+
+size_t estimateVcxprojItem(const ProjectItem& item){
+	return item.path.size() + 32;
+}
+
+size_t estimateFiltersItem(const ProjectItem& item){
+	return item.path.size() + item.filter.size() + 64;
+}
+
+void formatVcxprojItem(std::string& out, const char* tag, std::string_view path){
+	out.append("\t<").append(tag).append(" Include=\"").append(path).append("\" />\n");
+}
+
+void formatFiltersItem(std::string& out, std::string_view tag, std::string_view path, std::string_view filter){
+	out.append("\t<").append(tag).append(" Include=\"").append(path).append("\">\n");
+	out.append("\t\t<Filter>").append(filter).append("</Filter>\n");
+	out.append("\t</").append(tag).append(">\n");
+}
+
+void formatFilterDeclaration(std::string& out, std::string_view filter){
+	out.append("\t<Filter Include=\"").append(filter).append("\">\n");
+	// optional: out.append("\t	<UniqueIdentifier>").append("0").append("</UniqueIdentifier>\n");
+	out.append("\t</Filter>\n");
+}
+
+// Layout of the .vcxproj, the content of item groups being appended by the callers.
+template<typename Output, typename AppendIncludes, typename AppendCompiles>
+void layoutVcxproj(Output& vcxproj, const VcxprojTemplate& vcxprojTemplate, bool hasIncludes, bool hasCompiles, AppendIncludes appendIncludes, AppendCompiles appendCompiles){
+	vcxprojTemplate.appendHeader(vcxproj);
+
+	if(hasIncludes){
+		vcxproj.appendText("<ItemGroup>\n");
+		appendIncludes();
+		vcxproj.appendText("</ItemGroup>");
+		if( hasCompiles ){
+			vcxproj.appendText("\n");
+		}
+	}
+
+	if(hasCompiles){
+		vcxproj.appendText("<ItemGroup>\n");
+		appendCompiles();
+		vcxproj.appendText("</ItemGroup>");
+	}
+
+	vcxprojTemplate.appendFooter(vcxproj);
+}
+
+// Layout of the .vcxproj.filters, the content of item groups being appended by the callers.
+template<typename Output, typename AppendFilters, typename AppendIncludes, typename AppendCompiles>
+void layoutFilters(Output& filters, bool hasFilters, bool hasIncludes, bool hasCompiles, AppendFilters appendFilters, AppendIncludes appendIncludes, AppendCompiles appendCompiles){
+	filters.appendText("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+	filters.appendText("<Project ToolsVersion=\"4.0\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n");
+	filters.appendText("\n");
+
+	if(hasFilters){
+		filters.appendText("<ItemGroup>\n");
+		appendFilters();
+		filters.appendText("</ItemGroup>\n");
+		filters.appendText("\n");
+	}
+
+	if(hasIncludes){
+		filters.appendText("<ItemGroup>\n");
+		appendIncludes();
+		filters.appendText("</ItemGroup>\n");
+		filters.appendText("\n");
+	}
+
+	if(hasCompiles){
+		filters.appendText("<ItemGroup>\n");
+		appendCompiles();
+		filters.appendText("</ItemGroup>\n");
+		filters.appendText("\n");
+	}
+
+	filters.appendText("</Project>\n");
+}
+
+void generateVcxproj(ChunkedOutput& vcxproj, TaskPool& pool, const VcxprojTemplate& vcxprojTemplate, const std::vector<ProjectItem>& includeItems, const std::vector<ProjectItem>& compileItems){
+	layoutVcxproj(vcxproj, vcxprojTemplate, !includeItems.empty(), !compileItems.empty(), [&](){
+		vcxproj.appendItems(pool, includeItems, estimateVcxprojItem, [](std::string& out, const ProjectItem& item){
+			formatVcxprojItem(out, "ClInclude", item.path);
+		});
+	}, [&](){
+		vcxproj.appendItems(pool, compileItems, estimateVcxprojItem, [](std::string& out, const ProjectItem& item){
+			formatVcxprojItem(out, "ClCompile", item.path);
+		});
+	});
+}
+
+// Source item types, the ones generated are also removed when their file isn't scanned anymore.
+enum class SourceItemKind {
+	None, Compile, Include, Other
+};
+
+SourceItemKind sourceItemKind(std::string_view type){
+	if(type == "ClCompile"){
+		return SourceItemKind::Compile;
+	}
+	if(type == "ClInclude"){
+		return SourceItemKind::Include;
+	}
+	if(type == "FXCompile" || type == "Text" || type == "None"){
+		return SourceItemKind::Other;
+	}
+	return SourceItemKind::None;
+}
+
+// Paths of project items are compared to scanned paths with the separators of the platform,
+// Visual Studio writing backslashes. Only paths with other separators are copied.
+std::string_view normalizeItemPath(std::string_view path, StringArena& strings){
+	const char otherSeparator = fs::path::preferred_separator == '/' ? '\\' : '/';
+	if(path.find(otherSeparator) == std::string_view::npos){
+		return path;
+	}
+	const std::string_view copy = strings.append(path);
+	std::replace(const_cast<char*>(copy.data()), const_cast<char*>(copy.data()) + copy.size(), otherSeparator, (char)fs::path::preferred_separator);
+	return copy;
+}
+
+// Element types that in-place updates keep for scanned files, by path, for include then compile files.
+// As in mergeVcxproj, a file listed with another source type keeps the first such element, unless
+// it is also listed with the item type of its kind.
+struct RetainedItemTypes {
+	std::unordered_map<std::string_view, std::string_view> types[2];
+	StringArena paths;
+
+	void collect(const VcxprojTemplate& vcxprojTemplate){
+		std::unordered_set<std::string_view> listedPaths[2];
+		for(const VcxprojTemplate::Item& item : vcxprojTemplate.groupItems()){
+			const SourceItemKind kind = item.path.empty() ? SourceItemKind::None : sourceItemKind(item.type);
+			if(kind == SourceItemKind::Compile || kind == SourceItemKind::Include){
+				listedPaths[kind == SourceItemKind::Compile].insert(normalizeItemPath(item.path, paths));
+			} else if(kind == SourceItemKind::Other){
+				const std::string_view path = normalizeItemPath(item.path, paths);
+				types[0].emplace(path, item.type);
+				types[1].emplace(path, item.type);
+			}
+		}
+		for(size_t kind = 0; kind < 2; ++kind){
+			for(const std::string_view path : listedPaths[kind]){
+				types[kind].erase(path);
+			}
+		}
+	}
+
+	std::string_view typeOf(std::string_view path, bool compile) const {
+		const std::unordered_map<std::string_view, std::string_view>& retained = types[compile];
+		if(!retained.empty()){
+			const auto type = retained.find(path);
+			if(type != retained.end()){
+				return type->second;
+			}
+		}
+		return compile ? "ClCompile" : "ClInclude";
+	}
+};
+
+void appendVcxprojGroup(std::string& out, const char* tag, const std::vector<ProjectItem>& items){
+	out.append("<ItemGroup>\n");
+	for(const ProjectItem& item : items){
+		formatVcxprojItem(out, tag, item.path);
+	}
+	out.append("</ItemGroup>");
+}
+
+// Update the items of the existing project: scanned files already listed keep their element
+// and metadata, others are added in order, and compile or include items of missing files are removed.
+// Groups without such items are copied as is.
+void mergeVcxproj(ChunkedOutput& vcxproj, const VcxprojTemplate& vcxprojTemplate, const std::vector<ProjectItem>& includeItems, const std::vector<ProjectItem>& compileItems){
+	using Group = VcxprojTemplate::Group;
+	using Item = VcxprojTemplate::Item;
+	const std::string_view content = vcxprojTemplate.content();
+	const std::vector<Group>& groups = vcxprojTemplate.itemGroups();
+	const std::vector<Item>& items = vcxprojTemplate.groupItems();
+	constexpr size_t noItem = std::numeric_limits<size_t>::max();
+
+	// Existing items by path, the first of each kind being the one kept.
+	struct ExistingItem {
+		size_t compile = noItem;
+		size_t include = noItem;
+		size_t other = noItem;
+	};
+	std::unordered_map<std::string_view, ExistingItem> existingItems;
+	existingItems.reserve(items.size());
+	std::vector<SourceItemKind> kinds(items.size());
+	std::vector<std::string_view> paths(items.size());
+	std::vector<char> kept(items.size(), 1);
+	StringArena strings;
+	for(size_t i = 0; i < items.size(); ++i){
+		kinds[i] = items[i].path.empty() ? SourceItemKind::None : sourceItemKind(items[i].type);
+		if(kinds[i] == SourceItemKind::None){
+			continue;
+		}
+		paths[i] = normalizeItemPath(items[i].path, strings);
+		ExistingItem& existing = existingItems[paths[i]];
+		size_t& index = kinds[i] == SourceItemKind::Compile ? existing.compile : (kinds[i] == SourceItemKind::Include ? existing.include : existing.other);
+		index = index == noItem ? i : index;
+		kept[i] = kinds[i] == SourceItemKind::Other ? 1 : 0;
+	}
+	// Other source types can stand for both kinds of scanned files.
+	auto retain = [&](const std::vector<ProjectItem>& scanned, bool compile, std::vector<ProjectItem>& added){
+		for(const ProjectItem& item : scanned){
+			const auto existing = existingItems.find(item.path);
+			const size_t index = existing == existingItems.end() ? noItem : (compile ? existing->second.compile : existing->second.include);
+			if(index != noItem){
+				kept[index] = 1;
+			} else if(existing == existingItems.end() || existing->second.other == noItem){
+				added.push_back(item);
+			}
+		}
+	};
+	std::vector<ProjectItem> addedIncludes;
+	std::vector<ProjectItem> addedCompiles;
+	retain(includeItems, false, addedIncludes);
+	retain(compileItems, true, addedCompiles);
+
+	// Added items go in the first plain group with items of their kind, or in new groups
+	// around the updated ones.
+	constexpr size_t noGroup = std::numeric_limits<size_t>::max();
+	size_t includeGroup = noGroup;
+	size_t compileGroup = noGroup;
+	size_t firstUpdated = noGroup;
+	size_t lastUpdated = noGroup;
+	std::vector<size_t> keptCounts(groups.size(), 0);
+	for(size_t g = 0; g < groups.size(); ++g){
+		bool updated = false;
+		for(size_t i = groups[g].firstItem; i < groups[g].firstItem + groups[g].itemCount; ++i){
+			keptCounts[g] += kept[i];
+			const bool compile = kinds[i] == SourceItemKind::Compile;
+			if(!compile && kinds[i] != SourceItemKind::Include){
+				continue;
+			}
+			updated = true;
+			size_t& target = compile ? compileGroup : includeGroup;
+			target = (target == noGroup && groups[g].plain) ? g : target;
+		}
+		if(updated){
+			firstUpdated = firstUpdated == noGroup ? g : firstUpdated;
+			lastUpdated = g;
+		}
+	}
+	if(includeGroup != noGroup){
+		keptCounts[includeGroup] += addedIncludes.size();
+	}
+	if(compileGroup != noGroup){
+		keptCounts[compileGroup] += addedCompiles.size();
+	}
+
+	size_t position = 0;
+	auto copyTo = [&](size_t offset){
+		if(offset > position){
+			vcxproj.appendView(content.substr(position, offset - position));
+		}
+		position = std::max(position, offset);
+	};
+	// Start of the line of a tag, if only indented.
+	auto lineStart = [&](size_t offset){
+		while(offset > position && (content[offset - 1] == ' ' || content[offset - 1] == '\t')){
+			--offset;
+		}
+		return offset;
+	};
+	auto appendGroups = [&](bool includes, bool compiles, std::string_view before, std::string_view after){
+		std::string text;
+		if(includes){
+			text.append(before);
+			appendVcxprojGroup(text, "ClInclude", addedIncludes);
+			text.append(after);
+		}
+		if(compiles){
+			text.append(before);
+			appendVcxprojGroup(text, "ClCompile", addedCompiles);
+			text.append(after);
+		}
+		vcxproj.appendText(std::move(text));
+	};
+	const bool newIncludeGroup = includeGroup == noGroup && !addedIncludes.empty();
+	const bool newCompileGroup = compileGroup == noGroup && !addedCompiles.empty();
+
+	for(size_t g = firstUpdated; g <= lastUpdated && g != noGroup; ++g){
+		const Group& group = groups[g];
+		if(g == firstUpdated && newIncludeGroup){
+			// Replacing the first group if it is emptied.
+			if(keptCounts[g] == 0){
+				copyTo(group.begin);
+				appendGroups(true, false, "", "");
+				position = group.end;
+				continue;
+			}
+			copyTo(lineStart(group.begin));
+			appendGroups(true, false, "", "\n");
+		}
+		bool updated = false;
+		for(size_t i = group.firstItem; i < group.firstItem + group.itemCount; ++i){
+			updated = updated || kinds[i] == SourceItemKind::Compile || kinds[i] == SourceItemKind::Include;
+		}
+		if(!updated){
+			continue;
+		}
+		if(keptCounts[g] == 0){
+			// Remove the emptied group with its line.
+			size_t begin = lineStart(group.begin);
+			begin -= (begin > position && content[begin - 1] == '\n') ? 1 : 0;
+			begin -= (begin > position && content[begin - 1] == '\r') ? 1 : 0;
+			copyTo(begin);
+			position = group.end;
+			continue;
+		}
+		copyTo(group.contentBegin);
+		// New items use the indentation of the first one.
+		const std::string_view indent = group.itemCount != 0 ? content.substr(items[group.firstItem].leadBegin, items[group.firstItem].begin - items[group.firstItem].leadBegin) : std::string_view("\n\t");
+		size_t nextInclude = 0;
+		size_t nextCompile = 0;
+		auto appendAdded = [&](const std::vector<ProjectItem>& added, size_t& next, const char* tag, const std::string_view* before){
+			std::string text;
+			for(; next < added.size() && (before == nullptr || lessPath(added[next].path, *before)); ++next){
+				text.append(indent).append("<").append(tag).append(" Include=\"").append(added[next].path).append("\" />");
+			}
+			if(!text.empty()){
+				vcxproj.appendText(std::move(text));
+			}
+		};
+		for(size_t i = group.firstItem; i < group.firstItem + group.itemCount; ++i){
+			const Item& item = items[i];
+			copyTo(item.leadBegin);
+			if(g == includeGroup && kinds[i] == SourceItemKind::Include){
+				appendAdded(addedIncludes, nextInclude, "ClInclude", &paths[i]);
+			}
+			if(g == compileGroup && kinds[i] == SourceItemKind::Compile){
+				appendAdded(addedCompiles, nextCompile, "ClCompile", &paths[i]);
+			}
+			if(!kept[i]){
+				position = item.end;
+			}
+		}
+		copyTo(group.itemCount != 0 ? items[group.firstItem + group.itemCount - 1].end : group.contentBegin);
+		if(g == includeGroup){
+			appendAdded(addedIncludes, nextInclude, "ClInclude", nullptr);
+		}
+		if(g == compileGroup){
+			appendAdded(addedCompiles, nextCompile, "ClCompile", nullptr);
+		}
+	}
+	// New groups after the updated ones, or the last group, or before the end of the project.
+	if(newCompileGroup || (newIncludeGroup && firstUpdated == noGroup)){
+		const size_t anchor = lastUpdated != noGroup ? lastUpdated : (groups.empty() ? noGroup : groups.size() - 1);
+		const bool includes = newIncludeGroup && firstUpdated == noGroup;
+		if(anchor != noGroup){
+			copyTo(groups[anchor].end);
+			appendGroups(includes, newCompileGroup, "\n", "");
+		} else if(vcxprojTemplate.projectEndOffset() != std::string_view::npos){
+			copyTo(lineStart(vcxprojTemplate.projectEndOffset()));
+			appendGroups(includes, newCompileGroup, "", "\n");
+		}
+	}
+	copyTo(content.size());
+}
+
+// Items use the element type kept by the project, the retained types being empty unless updated in place.
+void generateFilters(ChunkedOutput& filters, TaskPool& pool, const std::vector<std::string_view>& filterPaths, const std::vector<ProjectItem>& includeItems, const std::vector<ProjectItem>& compileItems, const RetainedItemTypes& itemTypes){
+	layoutFilters(filters, !filterPaths.empty(), !includeItems.empty(), !compileItems.empty(), [&](){
+		filters.appendItems(pool, filterPaths, [](std::string_view filter){ return filter.size() + 40; }, formatFilterDeclaration);
+	}, [&](){
+		filters.appendItems(pool, includeItems, estimateFiltersItem, [&itemTypes](std::string& out, const ProjectItem& item){
+			formatFiltersItem(out, itemTypes.typeOf(item.path, false), item.path, item.filter);
+		});
+	}, [&](){
+		filters.appendItems(pool, compileItems, estimateFiltersItem, [&itemTypes](std::string& out, const ProjectItem& item){
+			formatFiltersItem(out, itemTypes.typeOf(item.path, true), item.path, item.filter);
+		});
+	});
+}
+
+// --------------------------------------------------------------------------------
+//	Output files
+// --------------------------------------------------------------------------------
+
+enum class WriteStatus {
+	Unchanged, Written, Failed
+};
+
+// Temporary files are created next to their destination for the rename to be atomic,
+// and named after the process so that concurrent runs never share one.
+fs::path temporaryPathFor(const fs::path& path){
+#ifdef _WIN32
+	const int processId = _getpid();
+#else
+	const int processId = (int)getpid();
+#endif
+	fs::path tempPath = path;
+	tempPath += "." + std::to_string(processId) + ".tmp";
+	return tempPath;
+}
+
+// The temporary file is created with default permissions, give it those of the file it replaces.
+void copyPermissions(const fs::path& from, const fs::path& to){
+	std::error_code error;
+	const fs::file_status status = fs::status(from, error);
+	if(!error && fs::exists(status)){
+		fs::permissions(to, status.permissions(), error);
+	}
+}
+
+// Files are written in text mode: on Windows, line endings are expanded in the buffer
+// so that it can be compared and written as is.
+#ifdef _WIN32
+void expandLineEndings(std::string& content){
+	const size_t lineCount = (size_t)std::count(content.begin(), content.end(), '\n');
+	if(lineCount == 0){
+		return;
+	}
+	std::string expandedContent;
+	expandedContent.reserve(content.size() + lineCount);
+	for(const char c : content){
+		if(c == '\n'){
+			expandedContent.push_back('\r');
+		}
+		expandedContent.push_back(c);
+	}
+	content.swap(expandedContent);
+}
+#endif
+
+// Only replace a file if its content differs, to preserve its modification time. The new
+// content is written at once to a temporary file renamed over the destination, so that
+// readers never observe a partially written file.
+WriteStatus writeFileIfChanged(const fs::path& path, std::string& content){
+#ifdef _WIN32
+	expandLineEndings(content);
+#endif
+	{
+		MappedFile existingFile;
+		if(existingFile.open(path) && existingFile.size() == content.size() && (content.empty() || std::memcmp(existingFile.data(), content.data(), content.size()) == 0)){
+			return WriteStatus::Unchanged;
+		}
+	}
+
+	const fs::path tempPath = temporaryPathFor(path);
+	std::error_code error;
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if(!file.is_open()){
+			return WriteStatus::Failed;
+		}
+		file.write(content.data(), (std::streamsize)content.size());
+		file.close();
+		if(file.fail()){
+			fs::remove(tempPath, error);
+			return WriteStatus::Failed;
+		}
+	}
+	copyPermissions(path, tempPath);
+	fs::rename(tempPath, path, error);
+	if(error){
+		fs::remove(tempPath, error);
+		return WriteStatus::Failed;
+	}
+	return WriteStatus::Written;
+}
+
+// --------------------------------------------------------------------------------
+//	Project files
+// --------------------------------------------------------------------------------
+
+struct ProjectPaths {
+	fs::path projectPath;
+	fs::path outputVcxprojPath;
+	fs::path outputFilterPath;
+	std::string projectName;
+};
+
+bool reportWriteStatus(const fs::path& path, WriteStatus status, std::ostream& log){
+	if(status == WriteStatus::Failed){
+		log << "Error" << std::endl;
+		return false;
+	}
+	log << (status == WriteStatus::Written ? "Written " : "Unchanged ") << path.string() << std::endl;
+	return true;
+}
+
+// Replace the outputs that changed, reporting for each of them.
+bool writeProjectOutputs(const ProjectPaths& project, ChunkedOutput& vcxproj, ChunkedOutput& filters, std::ostream& log){
+	std::string vcxprojContent = vcxproj.concatenate();
+	std::string filtersContent = filters.concatenate();
+	const std::pair<const fs::path&, std::string&> outputs[] = {
+		{ project.outputVcxprojPath, vcxprojContent },
+		{ project.outputFilterPath, filtersContent },
+	};
+	for(const auto& output : outputs){
+		if(!reportWriteStatus(output.first, writeFileIfChanged(output.first, output.second), log)){
+			return false;
+		}
+	}
+	return true;
+}
+
+// Generate .vcxproj and .vcxproj.filters concurrently, only replacing outputs that changed.
+// With in-place updates, the items of the existing project are merged with the scanned ones.
+bool writeProjectFiles(const ProjectPaths& project, const ProjectItems& items, bool inPlace, unsigned int workerCount, std::ostream& log){
+	VcxprojTemplate vcxprojTemplate;
+	vcxprojTemplate.load(project.projectPath, project.projectName);
+	TaskPool pool(workerCount);
+	ChunkedOutput vcxproj;
+	ChunkedOutput filters;
+	RetainedItemTypes itemTypes;
+	if(inPlace && vcxprojTemplate.updatable()){
+		mergeVcxproj(vcxproj, vcxprojTemplate, items.includeItems, items.compileItems);
+		itemTypes.collect(vcxprojTemplate);
+	} else {
+		generateVcxproj(vcxproj, pool, vcxprojTemplate, items.includeItems, items.compileItems);
+	}
+	generateFilters(filters, pool, items.filterPaths, items.includeItems, items.compileItems, itemTypes);
+	pool.run();
+	return writeProjectOutputs(project, vcxproj, filters, log);
+}
+
+// Report the entries missing from one sorted list or the other, returning their count.
+template<typename Less, typename Format>
+size_t reportDrift(const std::vector<ProjectItem>& existing, const std::vector<ProjectItem>& scanned, Less less, Format format, std::ostream& log){
+	size_t driftCount = 0;
+	size_t i = 0;
+	size_t j = 0;
+	while(i < existing.size() || j < scanned.size()){
+		if(j == scanned.size() || (i < existing.size() && less(existing[i], scanned[j]))){
+			log << "- ";
+			format(existing[i++]);
+			++driftCount;
+		} else if(i == existing.size() || less(scanned[j], existing[i])){
+			log << "+ ";
+			format(scanned[j++]);
+			++driftCount;
+		} else {
+			++i;
+			++j;
+		}
+	}
+	return driftCount;
+}
+
+// Compare the items of the existing project files to the scanned ones, without writing anything.
+bool checkProjectFiles(const ProjectPaths& project, const ProjectItems& items, bool inPlace, std::ostream& log){
+	// The filters share the layout of the project.
+	VcxprojTemplate vcxproj;
+	VcxprojTemplate filters;
+	vcxproj.load(project.outputVcxprojPath, project.projectName);
+	filters.load(project.outputFilterPath, project.projectName);
+
+	StringArena strings;
+	std::vector<ProjectItem> existingItems[2];
+	for(const VcxprojTemplate::Item& item : vcxproj.groupItems()){
+		const SourceItemKind kind = sourceItemKind(item.type);
+		if(kind == SourceItemKind::Compile || kind == SourceItemKind::Include){
+			existingItems[kind == SourceItemKind::Compile].push_back({ normalizeItemPath(item.path, strings), std::string_view() });
+		}
+	}
+	// Scanned files keep the element type of the project when updated in place, as when writing.
+	RetainedItemTypes itemTypes;
+	if(inPlace){
+		itemTypes.collect(vcxproj);
+	}
+	// Filter items by element type, other source types being only written by in-place updates.
+	std::map<std::string_view, std::vector<ProjectItem>> existingFilterItems;
+	std::vector<ProjectItem> existingFilters;
+	for(const VcxprojTemplate::Item& item : filters.groupItems()){
+		const SourceItemKind kind = sourceItemKind(item.type);
+		if(kind != SourceItemKind::None){
+			std::string_view filter;
+			findChildText(filters.content().substr(item.begin, item.end - item.begin), "Filter", filter);
+			existingFilterItems[item.type].push_back({ normalizeItemPath(item.path, strings), filter });
+		} else if(item.type == "Filter"){
+			existingFilters.push_back({ item.path, std::string_view() });
+		}
+	}
+
+	auto lessItem = [](const ProjectItem& itemA, const ProjectItem& itemB){
+		return lessPath(itemA.path, itemB.path) || (itemA.path == itemB.path && itemA.filter < itemB.filter);
+	};
+	auto lessFilter = [](const ProjectItem& filterA, const ProjectItem& filterB){
+		return filterA.path < filterB.path;
+	};
+	auto sortUnique = [](std::vector<ProjectItem>& entries, auto less){
+		std::sort(entries.begin(), entries.end(), less);
+		entries.erase(std::unique(entries.begin(), entries.end(), [&less](const ProjectItem& itemA, const ProjectItem& itemB){
+			return !less(itemA, itemB) && !less(itemB, itemA);
+		}), entries.end());
+	};
+	const char* const tags[2] = { "ClInclude", "ClCompile" };
+	const std::vector<ProjectItem>* const scannedItems[2] = { &items.includeItems, &items.compileItems };
+	// Scanned items stay sorted when split by element type.
+	std::map<std::string_view, std::vector<ProjectItem>> scannedFilterItems;
+	for(size_t kind = 0; kind < 2; ++kind){
+		for(const ProjectItem& item : *scannedItems[kind]){
+			scannedFilterItems[itemTypes.typeOf(item.path, kind != 0)].push_back(item);
+		}
+	}
+	std::vector<ProjectItem> scannedFilters;
+	scannedFilters.reserve(items.filterPaths.size());
+	for(const std::string_view filter : items.filterPaths){
+		scannedFilters.push_back({ filter, std::string_view() });
+	}
+
+	bool upToDate = true;
+	auto reportFile = [&](const fs::path& path, bool exists, auto compare){
+		std::ostringstream drift;
+		size_t driftCount = compare(drift);
+		if(!exists){
+			log << "Missing " << path.string() << std::endl;
+		} else if(driftCount != 0){
+			log << "Outdated " << path.string() << std::endl << drift.str();
+		} else {
+			log << "Up to date " << path.string() << std::endl;
+		}
+		upToDate = upToDate && exists && driftCount == 0;
+	};
+	reportFile(project.outputVcxprojPath, !vcxproj.content().empty(), [&](std::ostream& drift){
+		size_t driftCount = 0;
+		for(size_t kind = 0; kind < 2; ++kind){
+			// Scanned files already listed with another source type are kept by in-place updates.
+			std::vector<ProjectItem> scanned;
+			scanned.reserve(scannedItems[kind]->size());
+			for(const ProjectItem& item : *scannedItems[kind]){
+				if(itemTypes.typeOf(item.path, kind != 0) == tags[kind]){
+					scanned.push_back({ item.path, std::string_view() });
+				}
+			}
+			sortUnique(existingItems[kind], lessItem);
+			driftCount += reportDrift(existingItems[kind], scanned, lessItem, [&drift, &tags, kind](const ProjectItem& item){
+				drift << tags[kind] << " " << item.path << std::endl;
+			}, drift);
+		}
+		return driftCount;
+	});
+	reportFile(project.outputFilterPath, !filters.content().empty(), [&](std::ostream& drift){
+		sortUnique(existingFilters, lessFilter);
+		size_t driftCount = reportDrift(existingFilters, scannedFilters, lessFilter, [&drift](const ProjectItem& filter){
+			drift << "Filter " << filter.path << std::endl;
+		}, drift);
+		// Both maps list every element type found, to report items of types not expected anymore.
+		for(const auto& type : existingFilterItems){
+			scannedFilterItems[type.first];
+		}
+		for(auto& type : scannedFilterItems){
+			std::vector<ProjectItem>& existing = existingFilterItems[type.first];
+			sortUnique(existing, lessItem);
+			const std::string_view tag = type.first;
+			driftCount += reportDrift(existing, type.second, lessItem, [&drift, tag](const ProjectItem& item){
+				drift << tag << " " << item.path;
+				if(!item.filter.empty()){
+					drift << " (" << item.filter << ")";
+				}
+				drift << std::endl;
+			}, drift);
+		}
+		return driftCount;
+	});
+	return upToDate;
+}
+
+// Check that the source items of the existing project exist, without scanning the input directory.
+bool verifyProjectItems(const ProjectPaths& project, const fs::path& inputDirPath, unsigned int workerCount, std::ostream& log){
+	VcxprojTemplate vcxproj;
+	vcxproj.load(project.outputVcxprojPath, project.projectName);
+	if(vcxproj.content().empty()){
+		log << "Missing " << project.outputVcxprojPath.string() << std::endl;
+		return false;
+	}
+	// Item paths are relative to the input directory. Wildcards and properties can't be checked.
+	StringArena strings;
+	std::vector<std::string_view> paths;
+	std::unordered_set<std::string_view> listedPaths;
+	for(const VcxprojTemplate::Item& item : vcxproj.groupItems()){
+		if(item.path.empty() || sourceItemKind(item.type) == SourceItemKind::None || item.path.find_first_of("*?$%") != std::string_view::npos){
+			continue;
+		}
+		if(!listedPaths.insert(item.path).second){
+			continue;
+		}
+		// Copies are null-terminated, with the separators of the platform.
+		const std::string_view path = strings.append(item.path);
+		std::replace(const_cast<char*>(path.data()), const_cast<char*>(path.data()) + path.size(), fs::path::preferred_separator == '/' ? '\\' : '/', (char)fs::path::preferred_separator);
+		paths.push_back(path);
+	}
+	std::vector<unsigned char> isFile;
+	statFiles(inputDirPath, paths, isFile, workerCount);
+
+	size_t missingCount = 0;
+	for(size_t i = 0; i < paths.size(); ++i){
+		if(!isFile[i]){
+			log << "Missing item " << paths[i] << std::endl;
+			++missingCount;
+		}
+	}
+	if(missingCount != 0){
+		log << missingCount << " of " << paths.size() << " items missing in " << project.outputVcxprojPath.string() << std::endl;
+		return false;
+	}
+	log << "All " << paths.size() << " items present in " << project.outputVcxprojPath.string() << std::endl;
+	return true;
+}
+
+// --------------------------------------------------------------------------------
+//	Batch manifest
+// --------------------------------------------------------------------------------
+
+struct ProjectArguments {
+	fs::path projectPath;
+	fs::path inputDirPath;
+	std::string compileExtensionsList;
+	std::string includeExtensionsList;
+	std::string excludedDirs;
+};
+
+// Positional arguments of a project, relative paths being resolved from the base directory.
+bool parseProjectArguments(const std::vector<std::string>& args, const fs::path& baseDirPath, ProjectArguments& project){
+	if(args.size() < 2 || args.size() > 5){
+		return false;
+	}
+	project.projectPath = baseDirPath / fs::path(args[ 0 ]);
+	project.inputDirPath = baseDirPath / fs::path(args[ 1 ]);
+	project.compileExtensionsList = args.size() > 2 ? args[2] : "";
+	project.includeExtensionsList = args.size() > 3 ? args[3] : "";
+	project.excludedDirs = args.size() > 4 ? args[4] : "";
+	return true;
+}
+
+// Split a manifest line on spaces, double quotes grouping words.
+std::vector<std::string> splitManifestLine(const std::string& line){
+	std::vector<std::string> tokens;
+	std::string token;
+	bool quoted = false;
+	bool hasToken = false;
+	for(const char c : line){
+		if(c == '"'){
+			quoted = !quoted;
+			hasToken = true;
+		} else if(!quoted && (c == ' ' || c == '\t' || c == '\r')){
+			if(hasToken){
+				tokens.emplace_back(std::move(token));
+				token.clear();
+				hasToken = false;
+			}
+		} else {
+			token.push_back(c);
+			hasToken = true;
+		}
+	}
+	if(hasToken){
+		tokens.emplace_back(std::move(token));
+	}
+	return tokens;
+}
+
+// One project per line, with the same arguments as the command line.
+// Empty lines and lines starting with # are ignored, paths are relative to the manifest.
+bool loadBatchManifest(const fs::path& manifestPath, std::vector<ProjectArguments>& projects){
+	std::ifstream manifest( manifestPath );
+	if( !manifest.is_open() ){
+		std::cout << "Unable to read manifest " << manifestPath.string() << std::endl;
+		return false;
+	}
+	const fs::path baseDirPath = manifestPath.parent_path();
+	std::string line;
+	unsigned int lineIndex = 0;
+	while( std::getline( manifest, line ) ){
+		++lineIndex;
+		const std::string content = trim( line, " \t\r" );
+		if( content.empty() || content[0] == '#' ){
+			continue;
+		}
+		ProjectArguments project;
+		if( !parseProjectArguments( splitManifestLine( content ), baseDirPath, project ) ){
+			std::cout << "Invalid project at line " << lineIndex << " of " << manifestPath.string() << std::endl;
+			return false;
+		}
+		projects.emplace_back( std::move( project ) );
+	}
+	return true;
+}
+
+// Deepest directory containing both paths.
+fs::path commonAncestorPath(const fs::path& pathA, const fs::path& pathB){
+	fs::path commonPath;
+	auto componentA = pathA.begin();
+	auto componentB = pathB.begin();
+	for(; componentA != pathA.end() && componentB != pathB.end() && *componentA == *componentB; ++componentA, ++componentB){
+		commonPath /= *componentA;
+	}
+	return commonPath;
+}
+
+// --------------------------------------------------------------------------------
+//	External memory
+// --------------------------------------------------------------------------------
+// Under a memory budget, generated text is moved to anonymous temporary files once the
+// buffered size exceeds the budget, and outputs are written progressively from them.
+
+// Text appended in memory, moved to a temporary file on demand and read back in order.
+class SpillBuffer {
+public:
+
+	SpillBuffer() = default;
+	SpillBuffer(const SpillBuffer&) = delete;
+	SpillBuffer& operator=(const SpillBuffer&) = delete;
+
+	~SpillBuffer(){
+		if(file != nullptr){
+			std::fclose(file);
+		}
+	}
+
+	std::string& text(){
+		return buffer;
+	}
+
+	bool empty() const {
+		return spilledSize == 0 && buffer.empty();
+	}
+
+	size_t bufferedSize() const {
+		return buffer.size();
+	}
+
+	// The buffer keeps its capacity, as it will grow again.
+	bool spill(){
+		if(buffer.empty()){
+			return true;
+		}
+		if(file == nullptr){
+			file = std::tmpfile();
+			if(file == nullptr){
+				return false;
+			}
+		}
+		if(std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()){
+			return false;
+		}
+		spilledSize += buffer.size();
+		buffer.clear();
+		return true;
+	}
+
+	// Spilled text then the buffer, in pieces.
+	template<typename Writer>
+	bool read(Writer write){
+		if(file != nullptr){
+			std::rewind(file);
+			std::vector<char> chunk(1 << 16);
+			size_t remainingSize = spilledSize;
+			while(remainingSize != 0){
+				const size_t readSize = std::fread(chunk.data(), 1, std::min(chunk.size(), remainingSize), file);
+				if(readSize == 0){
+					return false;
+				}
+				write(std::string_view(chunk.data(), readSize));
+				remainingSize -= readSize;
+			}
+		}
+		write(std::string_view(buffer));
+		return true;
+	}
+
+private:
+
+	std::string buffer;
+	std::FILE* file = nullptr;
+	size_t spilledSize = 0;
+};
+
+// Position in a temporary file, which can exceed the range of long.
+bool seekFile(std::FILE* file, uint64_t offset){
+#ifdef _WIN32
+	return _fseeki64(file, (int64_t)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Filters, discovered in walk order: runs are sorted and appended to a single temporary file,
+// then merged in byte order. Runs are merged early by groups of the same level, so that the
+// number of runs read at once stays bounded whatever the budget.
+class FilterRuns {
+public:
+
+	FilterRuns() = default;
+	FilterRuns(const FilterRuns&) = delete;
+	FilterRuns& operator=(const FilterRuns&) = delete;
+
+	~FilterRuns(){
+		if(file != nullptr){
+			std::fclose(file);
+		}
+	}
+
+	void add(std::string_view filter){
+		current.emplace_back(filter);
+		bufferedSize += filter.size() + sizeof(std::string);
+	}
+
+	size_t size() const {
+		return bufferedSize;
+	}
+
+	bool empty() const {
+		return runs.empty() && current.empty();
+	}
+
+	// Records are the size of the filter followed by its bytes.
+	bool spill(){
+		if(current.empty()){
+			return true;
+		}
+		sortStrings<false>(current, [](const std::string& filter){ return std::string_view(filter); }, 1);
+		if(file == nullptr){
+			file = std::tmpfile();
+			if(file == nullptr){
+				return false;
+			}
+		}
+		Run run = { fileSize, 0, 0 };
+		RunWriter writer(*this);
+		for(const std::string& filter : current){
+			writer.write(filter);
+		}
+		if(!writer.finish()){
+			return false;
+		}
+		run.end = fileSize;
+		runs.push_back(run);
+		current.clear();
+		bufferedSize = 0;
+		// Merge the last runs while they form a full group of the same level.
+		while(runs.size() >= mergeFanIn && runs[runs.size() - mergeFanIn].level == runs.back().level){
+			const size_t first = runs.size() - mergeFanIn;
+			Run merged = { fileSize, 0, runs.back().level + 1 };
+			RunWriter mergedWriter(*this);
+			if(!mergeRuns(first, [&mergedWriter](std::string_view filter){ mergedWriter.write(filter); }) || !mergedWriter.finish()){
+				return false;
+			}
+			merged.end = fileSize;
+			runs.resize(first);
+			runs.push_back(merged);
+		}
+		return true;
+	}
+
+	// All filters in order, with a k-way merge of the runs.
+	template<typename Emit>
+	bool merge(Emit emit){
+		if(runs.empty()){
+			sortStrings<false>(current, [](const std::string& filter){ return std::string_view(filter); }, 1);
+			for(const std::string& filter : current){
+				emit(std::string_view(filter));
+			}
+			return true;
+		}
+		if(!spill()){
+			return false;
+		}
+		return mergeRuns(0, emit);
+	}
+
+private:
+
+	static constexpr size_t mergeFanIn = 64;
+	static constexpr size_t readBufferSize = 16 * 1024;
+
+	struct Run {
+		uint64_t begin;
+		uint64_t end;
+		unsigned int level;
+	};
+
+	// Records appended at the end of the file, buffered as reads can move the file position.
+	class RunWriter {
+	public:
+
+		explicit RunWriter(FilterRuns& aRuns) : runs(aRuns) {}
+
+		void write(std::string_view filter){
+			const uint32_t size = (uint32_t)filter.size();
+			buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+			buffer.append(filter);
+			if(buffer.size() >= readBufferSize){
+				flush();
+			}
+		}
+
+		bool finish(){
+			flush();
+			return success;
+		}
+
+	private:
+
+		void flush(){
+			if(buffer.empty() || !success){
+				return;
+			}
+			success = seekFile(runs.file, runs.fileSize) && std::fwrite(buffer.data(), 1, buffer.size(), runs.file) == buffer.size();
+			runs.fileSize += buffer.size();
+			buffer.clear();
+		}
+
+		FilterRuns& runs;
+		std::string buffer;
+		bool success = true;
+	};
+
+	struct RunReader {
+		uint64_t position;
+		uint64_t end;
+		std::vector<char> buffer;
+		size_t offset = 0;
+		std::string head;
+	};
+
+	bool readBytes(RunReader& reader, char* data, size_t size){
+		while(size != 0){
+			if(reader.offset == reader.buffer.size()){
+				const size_t readSize = (size_t)std::min<uint64_t>(readBufferSize, reader.end - reader.position);
+				reader.buffer.resize(readSize);
+				reader.offset = 0;
+				if(readSize == 0 || !seekFile(file, reader.position) || std::fread(reader.buffer.data(), 1, readSize, file) != readSize){
+					return false;
+				}
+				reader.position += readSize;
+			}
+			const size_t copySize = std::min(size, reader.buffer.size() - reader.offset);
+			std::memcpy(data, reader.buffer.data() + reader.offset, copySize);
+			reader.offset += copySize;
+			data += copySize;
+			size -= copySize;
+		}
+		return true;
+	}
+
+	// Merge the runs from the given one to the last.
+	template<typename Emit>
+	bool mergeRuns(size_t first, Emit emit){
+		std::vector<RunReader> readers;
+		readers.reserve(runs.size() - first);
+		for(size_t runIndex = first; runIndex < runs.size(); ++runIndex){
+			readers.push_back({ runs[runIndex].begin, runs[runIndex].end, {}, 0, {} });
+		}
+		bool success = true;
+		auto readHead = [this, &success](RunReader& reader){
+			if(reader.offset == reader.buffer.size() && reader.position == reader.end){
+				return false;
+			}
+			uint32_t size = 0;
+			if(!readBytes(reader, reinterpret_cast<char*>(&size), sizeof(size))){
+				success = false;
+				return false;
+			}
+			reader.head.resize(size);
+			if(size != 0 && !readBytes(reader, &reader.head[0], size)){
+				success = false;
+				return false;
+			}
+			return true;
+		};
+		// Smallest head on top.
+		auto greaterHead = [&readers](size_t readerA, size_t readerB){
+			return readers[readerB].head < readers[readerA].head;
+		};
+		std::vector<size_t> heap;
+		for(size_t readerIndex = 0; readerIndex < readers.size(); ++readerIndex){
+			if(readHead(readers[readerIndex])){
+				heap.push_back(readerIndex);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), greaterHead);
+		while(!heap.empty()){
+			std::pop_heap(heap.begin(), heap.end(), greaterHead);
+			const size_t readerIndex = heap.back();
+			emit(std::string_view(readers[readerIndex].head));
+			if(readHead(readers[readerIndex])){
+				std::push_heap(heap.begin(), heap.end(), greaterHead);
+			} else {
+				heap.pop_back();
+			}
+		}
+		return success;
+	}
+
+	std::vector<std::string> current;
+	std::vector<Run> runs;
+	std::FILE* file = nullptr;
+	uint64_t fileSize = 0;
+	size_t bufferedSize = 0;
+};
+
+// Output written progressively to its temporary file, then compared to the existing file.
+class StreamedOutput {
+public:
+
+	explicit StreamedOutput(const fs::path& aPath) : path(aPath), tempPath(temporaryPathFor(aPath)), file(tempPath) {}
+
+	void appendText(std::string_view text){
+		file.write(text.data(), (std::streamsize)text.size());
+	}
+
+	void appendView(std::string_view view){
+		appendText(view);
+	}
+
+	bool appendSpill(SpillBuffer& buffer){
+		return buffer.read([this](std::string_view text){ appendText(text); });
+	}
+
+	// Discard the partial output, when its content couldn't be read back from the spills.
+	WriteStatus abort(){
+		std::error_code error;
+		file.close();
+		fs::remove(tempPath, error);
+		return WriteStatus::Failed;
+	}
+
+	WriteStatus finish(){
+		std::error_code error;
+		file.close();
+		if(file.fail()){
+			fs::remove(tempPath, error);
+			return WriteStatus::Failed;
+		}
+		{
+			MappedFile existingFile;
+			MappedFile newFile;
+			if(existingFile.open(path) && newFile.open(tempPath) && existingFile.size() == newFile.size() && (newFile.size() == 0 || std::memcmp(existingFile.data(), newFile.data(), newFile.size()) == 0)){
+				fs::remove(tempPath, error);
+				return WriteStatus::Unchanged;
+			}
+		}
+		copyPermissions(path, tempPath);
+		fs::rename(tempPath, path, error);
+		if(error){
+			fs::remove(tempPath, error);
+			return WriteStatus::Failed;
+		}
+		return WriteStatus::Written;
+	}
+
+private:
+
+	const fs::path path;
+	const fs::path tempPath;
+	std::ofstream file;
+};
+
+// Peak resident memory of the process in bytes, or zero if unavailable.
+size_t peakMemoryUsage(){
+#ifdef VISUALGEN_RUSAGE
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0){
+		return 0;
+	}
+	#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;
+	#else
+	return (size_t)usage.ru_maxrss * 1024u;
+	#endif
+#else
+	return 0;
+#endif
+}
+
+// Size in bytes, with an optional K, M or G suffix.
+bool parseMemorySize(const std::string& sizeStr, size_t& size){
+	char* end = nullptr;
+	const unsigned long long value = std::strtoull(sizeStr.c_str(), &end, 10);
+	if(end == sizeStr.c_str()){
+		return false;
+	}
+	const std::string suffix = end;
+	const size_t shift = suffix.empty() ? 0 : (suffix == "K" || suffix == "k") ? 10 : (suffix == "M" || suffix == "m") ? 20 : (suffix == "G" || suffix == "g") ? 30 : 64;
+	if(shift == 64){
+		return false;
+	}
+	size = (size_t)(value << shift);
+	return size != 0;
+}
+
+// --------------------------------------------------------------------------------
+//	Streaming generation
+// --------------------------------------------------------------------------------
+// Alternative to the scan and global sort for a single project: the walk visits entries
+// in sorted order, so items are produced in the output order and formatted right away.
+// Only the entries of the directories along the current path are kept in memory, and with
+// a memory budget the item groups and filters are spilled to temporary files.
+// The walk runs on the first worker of a pool, the others listing the next directories
+// of the walk in advance, a bounded number at a time.
+
+class ProjectStreamer {
+public:
+
+	ProjectStreamer(const ScanSettings& aSettings, size_t aMemoryBudget, unsigned int workerCount) : settings(aSettings), memoryBudget(aMemoryBudget), pool(workerCount),
+		prefetchWindow(workerCount > 1 ? prefetchPerWorker * workerCount : 0) {}
+
+	bool run(){
+		std::error_code error;
+		if(!fs::is_directory(settings.inputDirPath, error)){
+			return false;
+		}
+		std::string relativeDir;
+		std::string filter;
+		uint32_t exclusionState;
+		const ProjectMask mask = projectsAlongPath(settings, relativeDir, exclusionState);
+		const std::shared_ptr<Listing> rootListing = std::make_shared<Listing>(settings.inputDirPath, mask, exclusionState, true);
+		pool.push([&](unsigned int){
+			streamDirectory(*rootListing, relativeDir, filter, nullptr, filterDeclarations);
+		}, 0);
+		pool.run();
+		return true;
+	}
+
+	// Content of each item group, in order. Without budget, filters are declared in
+	// the first string, otherwise they are merged from the runs.
+	std::string filterDeclarations;
+	FilterRuns filterRuns;
+	SpillBuffer vcxprojIncludes;
+	SpillBuffer vcxprojCompiles;
+	SpillBuffer filtersIncludes;
+	SpillBuffer filtersCompiles;
+	size_t unreadableDirCount = 0;
+	size_t prunedDirCount = 0;
+	bool outOfDescriptors = false;
+	bool spillFailed = false;
+
+private:
+
+	struct Entry {
+		std::string name;
+		bool directory;
+		ProjectMask compileMask;
+		ProjectMask includeMask;
+	};
+
+	// Listing of a directory, performed by the first of the walk and a worker to claim it.
+	struct Listing {
+		const fs::path dirPath;
+		const ProjectMask mask;
+		const uint32_t exclusionState;
+		const bool isRoot;
+		// Only accessed by the walk.
+		bool prefetched = false;
+		std::atomic<bool> claimed{false};
+		std::mutex mutex;
+		std::condition_variable listedCondition;
+		bool listed = false;
+		ListStatus status = ListStatus::Unreadable;
+		std::vector<Entry> entries;
+
+		Listing(const fs::path& aDirPath, ProjectMask aMask, uint32_t aExclusionState, bool aIsRoot) : dirPath(aDirPath), mask(aMask), exclusionState(aExclusionState), isRoot(aIsRoot) {}
+	};
+
+	// Listings queued ahead of the walk for each worker.
+	static constexpr size_t prefetchPerWorker = 4;
+
+	void performListing(Listing& listing){
+		std::vector<Entry> entries;
+		const ListStatus status = listDirectory(listing.dirPath, listing.mask, listing.exclusionState, listing.isRoot, entries);
+		{
+			std::lock_guard<std::mutex> lock(listing.mutex);
+			listing.status = status;
+			listing.entries = std::move(entries);
+			listing.listed = true;
+		}
+		listing.listedCondition.notify_all();
+	}
+
+	// Queue the listings of the next subdirectories of a directory while the window allows it.
+	void prefetchListings(const std::vector<std::shared_ptr<Listing>>& listings, size_t& nextIndex){
+		for(; nextIndex < listings.size() && prefetchedCount < prefetchWindow; ++nextIndex){
+			const std::shared_ptr<Listing>& listing = listings[nextIndex];
+			if(listing == nullptr){
+				continue;
+			}
+			listing->prefetched = true;
+			++prefetchedCount;
+			pool.push([this, listing](unsigned int){
+				if(!listing->claimed.exchange(true)){
+					performListing(*listing);
+				}
+			}, (unsigned int)nextIndex);
+		}
+	}
+
+	// List the directory now if no worker has started it, otherwise wait for its entries.
+	void waitListing(Listing& listing){
+		if(listing.prefetched){
+			--prefetchedCount;
+		}
+		if(!listing.claimed.exchange(true)){
+			performListing(listing);
+			return;
+		}
+		std::unique_lock<std::mutex> lock(listing.mutex);
+		listing.listedCondition.wait(lock, [&listing](){ return listing.listed; });
+	}
+
+	// Subdirectories and files kept by the project, unsorted.
+	ListStatus listDirectory(const fs::path& dirPath, ProjectMask mask, uint32_t exclusionState, bool isRoot, std::vector<Entry>& entries){
+		auto keepFile = [&](std::string_view entryName){
+			ProjectMask compileMask;
+			ProjectMask includeMask;
+			classifyFilename(settings, mask, exclusionState, entryName, compileMask, includeMask);
+			return (compileMask | includeMask) != 0;
+		};
+		auto visit = [&](std::string_view entryName, EntryType type){
+			Entry entry = { std::string(entryName), type == EntryType::Directory, 0, 0 };
+			if(type == EntryType::File){
+				classifyFilename(settings, mask, exclusionState, entry.name, entry.compileMask, entry.includeMask);
+				if((entry.compileMask | entry.includeMask) == 0){
+					return;
+				}
+			} else if(type != EntryType::Directory){
+				return;
+			}
+			entries.emplace_back(std::move(entry));
+		};
+#ifdef VISUALGEN_NATIVE_SCAN
+		if(settings.nativeBackend){
+			// Never follow directory symlinks, except for the input directory itself.
+			const int fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | (isRoot ? 0 : O_NOFOLLOW));
+			if(fd < 0){
+				return listFailure(std::error_code(errno, std::generic_category()));
+			}
+			const ListStatus status = listNativeEntries(fd, keepFile, visit);
+			close(fd);
+			return status;
+		}
+#endif
+		(void)isRoot;
+		return listDirectoryEntries(dirPath, visit);
+	}
+
+	void spillIfOverBudget(){
+		if(memoryBudget == 0 || spillFailed){
+			return;
+		}
+		SpillBuffer* const sections[] = { &vcxprojIncludes, &vcxprojCompiles, &filtersIncludes, &filtersCompiles };
+		size_t bufferedSize = filterRuns.size();
+		for(const SpillBuffer* section : sections){
+			bufferedSize += section->bufferedSize();
+		}
+		if(bufferedSize <= memoryBudget){
+			return;
+		}
+		spillFailed = !filterRuns.spill();
+		for(SpillBuffer* section : sections){
+			spillFailed = !section->spill() || spillFailed;
+		}
+	}
+
+	// Stream the items of a directory and its subdirectories. The relative path and filter are
+	// extended in place for subdirectories. Filter declarations of the subdirectories are appended
+	// to the block. Returns true if the directory contains project files.
+	bool streamDirectory(Listing& listing, std::string& relativeDir, std::string& filter, const std::shared_ptr<const IgnoreRules>& parentIgnoreRules, std::string& filterBlock){
+		waitListing(listing);
+		const fs::path& dirPath = listing.dirPath;
+		const ProjectMask mask = listing.mask;
+		const uint32_t exclusionState = listing.exclusionState;
+		const ListStatus status = listing.status;
+		std::vector<Entry> entries = std::move(listing.entries);
+		if(status != ListStatus::Listed){
+			if(status == ListStatus::OutOfDescriptors){
+				outOfDescriptors = true;
+			} else {
+				++unreadableDirCount;
+			}
+			return false;
+		}
+		const std::shared_ptr<const IgnoreRules> ignoreRules = settings.gitignore ? loadIgnoreRules(dirPath, relativeDir, parentIgnoreRules) : nullptr;
+		if(ignoreRules != nullptr){
+			entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& entry){
+				return isIgnoredEntry(ignoreRules.get(), relativeDir, entry.name, entry.directory);
+			}), entries.end());
+		}
+		// Byte order of names gives the fs::path order of the paths below them.
+		std::sort(entries.begin(), entries.end(), [](const Entry& entryA, const Entry& entryB){
+			return entryA.name < entryB.name;
+		});
+
+		// Subdirectories to walk, in order, to be listed ahead.
+		const size_t relativeDirSize = relativeDir.size();
+		std::vector<std::shared_ptr<Listing>> subdirListings(entries.size());
+		for(size_t i = 0; i < entries.size(); ++i){
+			const Entry& entry = entries[i];
+			if(!entry.directory){
+				continue;
+			}
+			relativeDir.resize(relativeDirSize);
+			if(!relativeDir.empty()){
+				relativeDir.push_back((char)fs::path::preferred_separator);
+			}
+			relativeDir.append(entry.name);
+			if(isPrunedDirectory(settings, entry.name, relativeDir)){
+				++prunedDirCount;
+				continue;
+			}
+			uint32_t subdirExclusionState;
+			const ProjectMask subdirMask = subdirectoryProjects(settings, mask, exclusionState, relativeDir, subdirExclusionState);
+			if(isScannedDirectory(settings, subdirMask, relativeDir)){
+				subdirListings[i] = std::make_shared<Listing>(dirPath / entry.name, subdirMask, subdirExclusionState, false);
+			}
+		}
+		relativeDir.resize(relativeDirSize);
+		size_t nextPrefetch = 0;
+		prefetchListings(subdirListings, nextPrefetch);
+
+		// Filters are sorted on their whole string, where the backslash is not the lowest character:
+		// each subdirectory contributes its own filter, and the block of its subdirectories sorted
+		// as if its name ended with a backslash.
+		struct FilterBlock {
+			std::string key;
+			std::string declarations;
+		};
+		std::vector<FilterBlock> filterBlocks;
+
+		const size_t filterSize = filter.size();
+		bool hasFiles = false;
+		for(size_t i = 0; i < entries.size(); ++i){
+			const Entry& entry = entries[i];
+			if(entry.directory && subdirListings[i] == nullptr){
+				continue;
+			}
+			if(!relativeDir.empty()){
+				relativeDir.push_back((char)fs::path::preferred_separator);
+			}
+			relativeDir.append(entry.name);
+
+			if(entry.directory){
+				if(!filter.empty()){
+					filter.push_back('\\');
+				}
+				filter.append(entry.name);
+				// Listings consumed deeper in the walk free room for the following subdirectories,
+				// this one being listed right away if it hasn't been queued.
+				nextPrefetch = std::max(nextPrefetch, i + 1);
+				prefetchListings(subdirListings, nextPrefetch);
+				std::string block;
+				const bool subdirHasFiles = streamDirectory(*subdirListings[i], relativeDir, filter, ignoreRules, block);
+				subdirListings[i].reset();
+				if(subdirHasFiles){
+					hasFiles = true;
+					if(memoryBudget != 0){
+						filterRuns.add(filter);
+						spillIfOverBudget();
+					} else {
+						std::string declaration;
+						formatFilterDeclaration(declaration, filter);
+						filterBlocks.push_back({ entry.name, std::move(declaration) });
+						if(!block.empty()){
+							filterBlocks.push_back({ entry.name + "\\", std::move(block) });
+						}
+					}
+				}
+				filter.resize(filterSize);
+			} else {
+				hasFiles = true;
+				if(entry.includeMask & 1u){
+					formatVcxprojItem(vcxprojIncludes.text(), "ClInclude", relativeDir);
+					formatFiltersItem(filtersIncludes.text(), "ClInclude", relativeDir, filter);
+				}
+				if(entry.compileMask & 1u){
+					formatVcxprojItem(vcxprojCompiles.text(), "ClCompile", relativeDir);
+					formatFiltersItem(filtersCompiles.text(), "ClCompile", relativeDir, filter);
+				}
+				spillIfOverBudget();
+			}
+			relativeDir.resize(relativeDirSize);
+		}
+
+		std::sort(filterBlocks.begin(), filterBlocks.end(), [](const FilterBlock& blockA, const FilterBlock& blockB){
+			return blockA.key < blockB.key;
+		});
+		for(const FilterBlock& block : filterBlocks){
+			filterBlock.append(block.declarations);
+		}
+		return hasFiles;
+	}
+
+	const ScanSettings& settings;
+	const size_t memoryBudget;
+	TaskPool pool;
+	const size_t prefetchWindow;
+	// Listings queued and not yet consumed by the walk.
+	size_t prefetchedCount = 0;
+};
+
+// Outputs are written from the spilled item groups, and filters merged from their runs.
+bool writeSpilledProjectFiles(ProjectStreamer& streamer, const ProjectPaths& project, const VcxprojTemplate& vcxprojTemplate, std::ostream& log){
+	bool readSuccess = true;
+	StreamedOutput vcxproj(project.outputVcxprojPath);
+	layoutVcxproj(vcxproj, vcxprojTemplate, !streamer.vcxprojIncludes.empty(), !streamer.vcxprojCompiles.empty(), [&](){
+		readSuccess = vcxproj.appendSpill(streamer.vcxprojIncludes) && readSuccess;
+	}, [&](){
+		readSuccess = vcxproj.appendSpill(streamer.vcxprojCompiles) && readSuccess;
+	});
+	const WriteStatus vcxprojStatus = readSuccess ? vcxproj.finish() : vcxproj.abort();
+	if(!reportWriteStatus(project.outputVcxprojPath, vcxprojStatus, log)){
+		return false;
+	}
+
+	StreamedOutput filters(project.outputFilterPath);
+	layoutFilters(filters, !streamer.filterRuns.empty(), !streamer.filtersIncludes.empty(), !streamer.filtersCompiles.empty(), [&](){
+		std::string declaration;
+		readSuccess = streamer.filterRuns.merge([&filters, &declaration](std::string_view filter){
+			declaration.clear();
+			formatFilterDeclaration(declaration, filter);
+			filters.appendText(declaration);
+		}) && readSuccess;
+	}, [&](){
+		readSuccess = filters.appendSpill(streamer.filtersIncludes) && readSuccess;
+	}, [&](){
+		readSuccess = filters.appendSpill(streamer.filtersCompiles) && readSuccess;
+	});
+	const WriteStatus filtersStatus = readSuccess ? filters.finish() : filters.abort();
+	return reportWriteStatus(project.outputFilterPath, filtersStatus, log);
+}
+
+// Generate the project of the first settings entry while walking its input directory,
+// keeping generated text under the memory budget if there is one.
+bool streamProjectFiles(const ScanSettings& settings, const ProjectPaths& project, size_t memoryBudget, unsigned int workerCount, std::ostream& log){
+	ProjectStreamer streamer(settings, memoryBudget, workerCount);
+	if(!streamer.run()){
+		log << "Unable to read directory " << settings.inputDirPath.string() << std::endl;
+		return false;
+	}
+	if(streamer.outOfDescriptors){
+		log << "Too many open files to read directory " << settings.inputDirPath.string() << std::endl;
+		return false;
+	}
+	if(streamer.unreadableDirCount != 0){
+		log << "Skipped " << streamer.unreadableDirCount << " unreadable directories" << std::endl;
+	}
+	if(streamer.prunedDirCount != 0){
+		log << "Pruned " << streamer.prunedDirCount << " hidden or metadata directories" << std::endl;
+	}
+	if(streamer.spillFailed){
+		log << "Unable to write temporary files" << std::endl;
+		return false;
+	}
+
+	VcxprojTemplate vcxprojTemplate;
+	vcxprojTemplate.load(project.projectPath, project.projectName);
+	if(memoryBudget != 0){
+		return writeSpilledProjectFiles(streamer, project, vcxprojTemplate, log);
+	}
+	ChunkedOutput vcxproj;
+	ChunkedOutput filters;
+	layoutVcxproj(vcxproj, vcxprojTemplate, !streamer.vcxprojIncludes.empty(), !streamer.vcxprojCompiles.empty(), [&](){
+		vcxproj.appendText(std::move(streamer.vcxprojIncludes.text()));
+	}, [&](){
+		vcxproj.appendText(std::move(streamer.vcxprojCompiles.text()));
+	});
+	layoutFilters(filters, !streamer.filterDeclarations.empty(), !streamer.filtersIncludes.empty(), !streamer.filtersCompiles.empty(), [&](){
+		filters.appendText(std::move(streamer.filterDeclarations));
+	}, [&](){
+		filters.appendText(std::move(streamer.filtersIncludes.text()));
+	}, [&](){
+		filters.appendText(std::move(streamer.filtersCompiles.text()));
+	});
+	return writeProjectOutputs(project, vcxproj, filters, log);
+}
+
+#ifdef VISUALGEN_WATCH
+
+// --------------------------------------------------------------------------------
+//	Watch mode
+// --------------------------------------------------------------------------------
+
+// Keep the scan results up to date from inotify events on every scanned directory,
+// and regenerate the project files once changes have settled.
+class ProjectWatcher {
+public:
+
+	ProjectWatcher(const ProjectPaths& aProject, const ScanSettings& aSettings, bool aInPlace, unsigned int aWorkerCount) :
+		project(aProject), settings(aSettings), inPlace(aInPlace), workerCount(aWorkerCount) {
+		// Subtrees are always listed from disk, and their directories recorded to be watched.
+		settings.previousIndex = nullptr;
+		settings.recordIndex = true;
+	}
+
+	~ProjectWatcher(){
+		if(inotifyFd >= 0){
+			close(inotifyFd);
+		}
+	}
+
+	bool start(ScanResults& results, const std::vector<std::string>& directories){
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(inotifyFd < 0){
+			return false;
+		}
+		for(const std::string& directory : directories){
+			watchDirectory(directory);
+		}
+		addItems(results);
+		return watchDescriptors.count(std::string()) != 0;
+	}
+
+	bool run(){
+		// Wait for changes to settle, but regenerate at least every half second.
+		const std::chrono::milliseconds settleDelay(100);
+		const std::chrono::milliseconds maxDelay(500);
+		bool pendingChanges = false;
+		std::chrono::steady_clock::time_point firstChangeTime;
+
+		alignas(struct inotify_event) char buffer[64 * 1024];
+		while(true){
+			int timeout = -1;
+			if(pendingChanges){
+				const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - firstChangeTime);
+				timeout = (int)std::max<long long>(0, std::min<long long>(settleDelay.count(), (maxDelay - elapsed).count()));
+			}
+			struct pollfd pollInfo = { inotifyFd, POLLIN, 0 };
+			const int pollResult = poll(&pollInfo, 1, timeout);
+			if(pollResult < 0){
+				if(errno == EINTR){
+					continue;
+				}
+				return false;
+			}
+			if(pollResult > 0){
+				const ssize_t readSize = read(inotifyFd, buffer, sizeof(buffer));
+				if(readSize < 0 && errno != EAGAIN && errno != EINTR){
+					return false;
+				}
+				for(ssize_t offset = 0; offset < readSize;){
+					const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+					offset += sizeof(struct inotify_event) + event->len;
+					if(handleEvent(*event) && !pendingChanges){
+						pendingChanges = true;
+						firstChangeTime = std::chrono::steady_clock::now();
+					}
+				}
+			}
+			if(pendingChanges && (pollResult == 0 || (std::chrono::steady_clock::now() - firstChangeTime) >= maxDelay)){
+				pendingChanges = false;
+				regenerate();
+			}
+		}
+	}
+
+private:
+
+	// Returns true if the items have changed.
+	bool handleEvent(const struct inotify_event& event){
+		if(event.mask & IN_Q_OVERFLOW){
+			// Events have been lost, start from scratch.
+			rescan();
+			return true;
+		}
+		auto directory = watchedDirectories.find(event.wd);
+		if(directory == watchedDirectories.end()){
+			return false;
+		}
+		if(event.mask & IN_IGNORED){
+			// The directory might have been watched again since.
+			auto descriptor = watchDescriptors.find(directory->second);
+			if(descriptor != watchDescriptors.end() && descriptor->second == event.wd){
+				watchDescriptors.erase(descriptor);
+			}
+			watchedDirectories.erase(directory);
+			return false;
+		}
+		if(event.len == 0){
+			return false;
+		}
+		const std::string relativeDir = directory->second;
+		const std::string name = event.name;
+		const std::string entryPath = appendRelativePath(relativeDir, name);
+		const bool added = (event.mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+		const bool removed = (event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+		// Ignore rules could apply anywhere below, start from scratch.
+		if(settings.gitignore && name == ".gitignore" && !(event.mask & IN_ISDIR)){
+			rescan();
+			return true;
+		}
+
+		if(event.mask & IN_ISDIR){
+			uint32_t exclusionState;
+			if(!isScannedDirectory(settings, projectsAlongPath(settings, entryPath, exclusionState), entryPath)){
+				return false;
+			}
+			if(added && (isPrunedDirectory(settings, name, entryPath) || isIgnoredEntry(ignoreRulesAbove(settings, entryPath).get(), relativeDir, name, true))){
+				return false;
+			}
+			if(added){
+				addSubtree(entryPath);
+				return true;
+			}
+			if(removed){
+				removeSubtree(entryPath);
+				return true;
+			}
+			return false;
+		}
+		ProjectMask compileMask;
+		ProjectMask includeMask;
+		uint32_t exclusionState;
+		const ProjectMask mask = projectsAlongPath(settings, relativeDir, exclusionState);
+		classifyFilename(settings, mask, exclusionState, name, compileMask, includeMask);
+		const unsigned char kinds = fileKinds(compileMask, includeMask);
+		if(kinds == 0){
+			return false;
+		}
+		if(added){
+			if(isIgnoredEntry(ignoreRulesAbove(settings, entryPath).get(), relativeDir, name, false)){
+				return false;
+			}
+			// Symlinks are only kept if they point to a file.
+			std::error_code error;
+			if(!fs::is_regular_file(settings.inputDirPath / entryPath, error)){
+				return false;
+			}
+			return addItem(entryPath, kinds);
+		}
+		if(removed){
+			return removeItem(entryPath, FILE_COMPILE | FILE_INCLUDE);
+		}
+		return false;
+	}
+
+	void watchDirectory(const std::string& relativeDir){
+		if(watchDescriptors.count(relativeDir) != 0){
+			return;
+		}
+		const fs::path dirPath = relativeDir.empty() ? settings.inputDirPath : (settings.inputDirPath / relativeDir);
+		// Edited ignore files are only reported when closed.
+		const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK | (settings.gitignore ? IN_CLOSE_WRITE : 0);
+		const int wd = inotify_add_watch(inotifyFd, dirPath.c_str(), mask);
+		if(wd < 0){
+			if(!reportedWatchError){
+				std::cout << "Unable to watch " << dirPath.string() << " (" << std::strerror(errno) << ")" << std::endl;
+				reportedWatchError = true;
+			}
+			return;
+		}
+		watchedDirectories[wd] = relativeDir;
+		watchDescriptors[relativeDir] = wd;
+	}
+
+	void addSubtree(const std::string& relativeDir){
+		// Watch the new directories before listing them again, to catch entries created
+		// between the first listing and the watch registration.
+		for(int pass = 0; pass < 2; ++pass){
+			ScanResults results;
+			if(!scanInputDirectory(settings, workerCount, results, relativeDir)){
+				return;
+			}
+			if(results.outOfDescriptors){
+				std::cout << "Too many open files to read directory " << (settings.inputDirPath / relativeDir).string() << std::endl;
+			}
+			for(const IndexDirectoryRecord& record : results.directoryRecords){
+				watchDirectory(record.relativePath);
+			}
+			addItems(results);
+		}
+	}
+
+	void removeSubtree(const std::string& relativeDir){
+		const std::string prefix = relativeDir + (char)fs::path::preferred_separator;
+		for(auto item = items.lower_bound(fs::path(relativeDir)); item != items.end();){
+			const std::string& itemPath = item->first.native();
+			if(itemPath.compare(0, prefix.size(), prefix) != 0){
+				break;
+			}
+			updateDirectories(item->first, item->second, false);
+			item = items.erase(item);
+		}
+		// Directories moved elsewhere would still report events.
+		auto unwatch = [this](std::map<std::string, int>::iterator directory){
+			inotify_rm_watch(inotifyFd, directory->second);
+			watchedDirectories.erase(directory->second);
+			return watchDescriptors.erase(directory);
+		};
+		auto root = watchDescriptors.find(relativeDir);
+		if(root != watchDescriptors.end()){
+			unwatch(root);
+		}
+		for(auto directory = watchDescriptors.lower_bound(prefix); directory != watchDescriptors.end();){
+			if(directory->first.compare(0, prefix.size(), prefix) != 0){
+				break;
+			}
+			directory = unwatch(directory);
+		}
+	}
+
+	void rescan(){
+		for(const auto& directory : watchedDirectories){
+			inotify_rm_watch(inotifyFd, directory.first);
+		}
+		watchedDirectories.clear();
+		watchDescriptors.clear();
+		items.clear();
+		directoryCounts.clear();
+		addSubtree(std::string());
+	}
+
+	// Only a single project is watched.
+	static unsigned char fileKinds(ProjectMask compileMask, ProjectMask includeMask){
+		return ((compileMask & 1u) ? FILE_COMPILE : 0) | ((includeMask & 1u) ? FILE_INCLUDE : 0);
+	}
+
+	void addItems(ScanResults& results){
+		for(uint32_t id = 0; id < results.directories.size(); ++id){
+			results.directories.materialize(id, results.strings);
+		}
+		for(const ScannedFile& file : results.files){
+			const unsigned char kinds = fileKinds(file.compileMask, file.includeMask);
+			if(kinds != 0){
+				addItem(appendRelativePath(results.directories.path(file.directoryId), file.name), kinds);
+			}
+		}
+	}
+
+	bool addItem(const fs::path& path, unsigned char kinds){
+		unsigned char& itemKinds = items[path];
+		const unsigned char newKinds = kinds & ~itemKinds;
+		itemKinds |= kinds;
+		updateDirectories(path, newKinds, true);
+		return newKinds != 0;
+	}
+
+	bool removeItem(const fs::path& path, unsigned char kinds){
+		auto item = items.find(path);
+		if(item == items.end()){
+			return false;
+		}
+		const unsigned char oldKinds = item->second & kinds;
+		item->second &= ~kinds;
+		updateDirectories(path, oldKinds, false);
+		if(item->second == 0){
+			items.erase(item);
+		}
+		return oldKinds != 0;
+	}
+
+	// Filters are referenced once per compile item and once per include item below them.
+	void updateDirectories(const fs::path& path, unsigned char kinds, bool added){
+		const size_t count = ((kinds & FILE_COMPILE) ? 1 : 0) + ((kinds & FILE_INCLUDE) ? 1 : 0);
+		if(count == 0){
+			return;
+		}
+		visitDirectoriesAlongPath(path, [this, count, added](const std::string& filter){
+			if(added){
+				directoryCounts[filter] += count;
+				return true;
+			}
+			auto directory = directoryCounts.find(filter);
+			if(directory != directoryCounts.end()){
+				directory->second -= std::min(directory->second, count);
+				if(directory->second == 0){
+					directoryCounts.erase(directory);
+				}
+			}
+			return true;
+		});
+	}
+
+	void regenerate(){
+		// Ordered containers already follow the sorted output order.
+		ProjectItems projectItems;
+		for(const auto& item : items){
+			std::string filter = item.first.parent_path().string();
+			replace(filter, "/", "\\");
+			// Filters are owned by the directory counts, the root one being empty.
+			auto directory = directoryCounts.find(filter);
+			const ProjectItem projectItem = { projectItems.strings.append(item.first.string()), directory != directoryCounts.end() ? std::string_view(directory->first) : std::string_view() };
+			if(item.second & FILE_COMPILE){
+				projectItems.compileItems.push_back(projectItem);
+			}
+			if(item.second & FILE_INCLUDE){
+				projectItems.includeItems.push_back(projectItem);
+			}
+		}
+		projectItems.filterPaths.reserve(directoryCounts.size());
+		for(const auto& directory : directoryCounts){
+			projectItems.filterPaths.emplace_back(directory.first);
+		}
+		writeProjectFiles(project, projectItems, inPlace, workerCount, std::cout);
+	}
+
+	const ProjectPaths project;
+	ScanSettings settings;
+	const bool inPlace;
+	const unsigned int workerCount;
+
+	int inotifyFd = -1;
+	std::unordered_map<int, std::string> watchedDirectories;
+	std::map<std::string, int> watchDescriptors;
+	bool reportedWatchError = false;
+
+	// File items and their kinds, and number of items below each filter.
+	std::map<fs::path, unsigned char> items;
+	std::map<std::string, size_t> directoryCounts;
+};
+
+#endif
+
+// --------------------------------------------------------------------------------
+//	Go go go
+// --------------------------------------------------------------------------------
+
+int main(int argc, char** argv){
+
+	// Options are removed from the arguments, the remaining ones are positional.
+	unsigned int workerCount = std::thread::hardware_concurrency();
+#ifdef VISUALGEN_NATIVE_SCAN
+	bool nativeBackend = true;
+#else
+	bool nativeBackend = false;
+#endif
+	bool fullScan = false;
+	bool inPlace = false;
+	bool check = false;
+	bool verify = false;
+	bool watch = false;
+	bool stream = false;
+	bool gitignore = false;
+	bool pruneMetadataDirs = true;
+	bool caseInsensitiveExtensions = false;
+	InputSource source = InputSource::Disk;
+	std::string listPath;
+	size_t memoryBudget = 0;
+	fs::path manifestPath;
+	std::vector<std::string> args;
+	for(int i = 1; i < argc; ++i){
+		const std::string arg = argv[i];
+		if(arg.size() > 1 && arg[0] == '-'){
+			if(arg.compare(0, 2, "-j") == 0){
+				const std::string countStr = arg.size() > 2 ? arg.substr(2) : ((i + 1 < argc) ? argv[++i] : "");
+				workerCount = (unsigned int)std::strtoul(countStr.c_str(), nullptr, 10);
+				continue;
+			}
+			if(arg == "--full"){
+				fullScan = true;
+				continue;
+			}
+			if(arg == "--in-place"){
+				inPlace = true;
+				continue;
+			}
+			if(arg == "--check"){
+				check = true;
+				continue;
+			}
+			if(arg == "--verify"){
+				verify = true;
+				continue;
+			}
+			if(arg == "--watch"){
+#ifdef VISUALGEN_WATCH
+				watch = true;
+				continue;
+#else
+				std::cout << "Watch mode is not supported on this platform" << std::endl;
+				return 1;
+#endif
+			}
+			if(arg == "--ignore-extension-case"){
+				caseInsensitiveExtensions = true;
+				continue;
+			}
+			if(arg == "--no-prune"){
+				pruneMetadataDirs = false;
+				continue;
+			}
+			if(arg == "--gitignore"){
+				gitignore = true;
+				continue;
+			}
+			if(arg.compare(0, 9, "--source=") == 0){
+				const std::string sourceName = arg.substr(9);
+				if(sourceName == "disk" || sourceName == "git-index"){
+					source = sourceName == "disk" ? InputSource::Disk : InputSource::GitIndex;
+					continue;
+				}
+				if(sourceName == "list" || sourceName.compare(0, 5, "list:") == 0){
+					source = InputSource::List;
+					listPath = sourceName.size() > 5 ? sourceName.substr(5) : "";
+					continue;
+				}
+				std::cout << "Unsupported source " << sourceName << std::endl;
+				return 1;
+			}
+			if(arg == "--stream"){
+				stream = true;
+				continue;
+			}
+			if(arg.compare(0, 16, "--memory-budget=") == 0){
+				if(!parseMemorySize(arg.substr(16), memoryBudget)){
+					std::cout << "Invalid memory budget " << arg.substr(16) << std::endl;
+					return 1;
+				}
+				continue;
+			}
+			if(arg == "--batch" || arg.compare(0, 8, "--batch=") == 0){
+				manifestPath = arg.size() > 8 ? arg.substr(8) : ((i + 1 < argc) ? argv[++i] : "");
+				continue;
+			}
+			if(arg.compare(0, 10, "--backend=") == 0){
+				const std::string backend = arg.substr(10);
+				if(backend == "std"){
+					nativeBackend = false;
+					continue;
+				}
+#ifdef VISUALGEN_NATIVE_SCAN
+				if(backend == "native"){
+					nativeBackend = true;
+					continue;
+				}
+#endif
+				std::cout << "Unsupported backend " << backend << std::endl;
+				return 1;
+			}
+			std::cout << "Unknown option " << arg << std::endl;
+			std::cout << helpStr << std::endl;
+			return 1;
+		}
+		args.emplace_back(arg);
+	}
+	if(workerCount == 0){
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	// The memory budget relies on the ordered walk. Errors name the option actually given.
+	const std::string streamOption = stream ? "--stream" : "--memory-budget";
+	stream = stream || memoryBudget != 0;
+	if(watch && stream){
+		std::cout << "Watch mode and " << streamOption << " can't be combined" << std::endl;
+		return 1;
+	}
+	if(verify && (check || inPlace || watch || stream || source != InputSource::Disk)){
+		std::cout << "Verification only reads the existing projects and can't be combined with other modes" << std::endl;
+		return 1;
+	}
+	if(check && (watch || stream)){
+		std::cout << "Checking can't be combined with " << (watch ? std::string("watch mode") : streamOption) << std::endl;
+		return 1;
+	}
+	if(inPlace && stream){
+		std::cout << "In-place updates and " << streamOption << " can't be combined" << std::endl;
+		return 1;
+	}
+	if(source != InputSource::Disk && (watch || stream)){
+		std::cout << (watch ? std::string("Watch mode") : streamOption) << " requires the disk source" << std::endl;
+		return 1;
+	}
+	// Listed and git-indexed files aren't filtered by ignore files.
+	if(gitignore && source != InputSource::Disk){
+		std::cout << "--gitignore requires the disk source" << std::endl;
+		return 1;
+	}
+
+	// Parameters
+	const bool batch = !manifestPath.empty();
+	std::vector<ProjectArguments> projectArgs;
+	if(batch){
+		if(!args.empty()){
+			std::cout << "Projects of a batch are listed in its manifest, not on the command line" << std::endl;
+			std::cout << helpStr << std::endl;
+			return 1;
+		}
+		if(!loadBatchManifest(manifestPath, projectArgs)){
+			return 1;
+		}
+		if(watch || stream){
+			std::cout << (watch ? std::string("Watch mode") : streamOption) << " only supports a single project" << std::endl;
+			return 1;
+		}
+	} else {
+		projectArgs.emplace_back();
+		if(!parseProjectArguments(args, fs::path(), projectArgs.back())){
+			std::cout << helpStr << std::endl;
+			return 0;
+		}
+	}
+
+	// The list is shared by all groups of projects.
+	FileList fileList;
+	if(source == InputSource::List && !fileList.load(listPath)){
+		std::cout << "Unable to read file list " << (listPath.empty() ? std::string("from standard input") : listPath) << std::endl;
+		return 1;
+	}
+
+	bool success = true;
+	// Projects share a scan by groups, each with its own index.
+	for(size_t groupStart = 0; groupStart < projectArgs.size(); groupStart += maxProjectsPerScan){
+		const size_t groupEnd = std::min(projectArgs.size(), groupStart + maxProjectsPerScan);
+		const size_t groupIndex = groupStart / maxProjectsPerScan;
+
+		fs::path indexPath = batch ? manifestPath : projectArgs[groupStart].projectPath;
+		indexPath.replace_extension(groupIndex == 0 ? ".vgindex" : ("." + std::to_string(groupIndex) + ".vgindex"));
+
+		ScanSettings settings;
+		settings.nativeBackend = nativeBackend;
+		settings.gitignore = gitignore;
+		settings.pruneMetadataDirs = pruneMetadataDirs;
+		settings.caseInsensitiveExtensions = caseInsensitiveExtensions;
+		std::vector<ProjectPaths> projects;
+		std::vector<fs::path> projectRoots;
+		for(size_t i = groupStart; i < groupEnd; ++i){
+			const ProjectArguments& arguments = projectArgs[i];
+			const std::string projectName = arguments.projectPath.stem().string();
+			fs::path outputVcxprojPath = arguments.projectPath;
+			fs::path outputFilterPath = outputVcxprojPath;
+			outputVcxprojPath.replace_extension(".vcxproj");
+			outputFilterPath.replace_extension(".vcxproj.filters");
+
+			std::cout << "Processing " << arguments.inputDirPath.string() << " to " << outputVcxprojPath.string() << std::endl;
+
+			std::error_code error;
+			if(batch && !fs::is_directory(arguments.inputDirPath, error)){
+				std::cout << "Unable to read directory " << arguments.inputDirPath.string() << std::endl;
+				success = false;
+				continue;
+			}
+
+			ProjectScanSettings project;
+			project.compileExtensions = extractExtensions(arguments.compileExtensionsList);
+			project.includeExtensions = extractExtensions(arguments.includeExtensionsList);
+			project.noExtensionFilter = project.compileExtensions.empty() && project.includeExtensions.empty();
+			project.excludedPatterns = extractItems( arguments.excludedDirs );
+			project.generatedFilenames = { outputVcxprojPath.filename().string(), outputFilterPath.filename().string(), indexPath.filename().string() };
+			settings.projects.emplace_back(std::move(project));
+			projects.push_back({ arguments.projectPath, outputVcxprojPath, outputFilterPath, projectName });
+			projectRoots.emplace_back(batch ? fs::weakly_canonical(arguments.inputDirPath, error) : arguments.inputDirPath);
+		}
+		if(projects.empty()){
+			continue;
+		}
+		// Only the items listed by the projects are checked, without scanning.
+		if(verify){
+			for(size_t i = 0; i < projects.size(); ++i){
+				success = verifyProjectItems(projects[i], projectRoots[i], workerCount, std::cout) && success;
+			}
+			continue;
+		}
+
+		// A single project is scanned from its input directory as given,
+		// several ones from the deepest directory containing all of them.
+		settings.inputDirPath = projectRoots[0];
+		for(const fs::path& projectRoot : projectRoots){
+			settings.inputDirPath = commonAncestorPath(settings.inputDirPath, projectRoot);
+		}
+		for(size_t i = 0; i < projects.size(); ++i){
+			const std::string rootPath = projectRoots[i].lexically_relative(settings.inputDirPath).string();
+			settings.projects[i].rootPath = rootPath == "." ? std::string() : rootPath;
+		}
+		settings.finalizeProjects();
+
+		// Items are produced in order during the walk, without index.
+		if(stream){
+			success = streamProjectFiles(settings, projects[0], memoryBudget, workerCount, std::cout) && success;
+			continue;
+		}
+
+		ScanResults results;
+		std::vector<std::string> scannedDirectories;
+		if(source == InputSource::GitIndex){
+			// Tracked files are listed by the index, without walking the disk.
+			if(!listGitIndexFiles(settings, results)){
+				std::cout << "Unable to read the git index of " << settings.inputDirPath.string() << std::endl;
+				success = false;
+				continue;
+			}
+		} else if(source == InputSource::List){
+			if(!listFiles(settings, fileList, results)){
+				std::cout << "Directory " << settings.inputDirPath.string() << " is not below the current directory" << std::endl;
+				success = false;
+				continue;
+			}
+		} else {
+			// Reuse the previous scan for unmodified directories, unless a full scan is requested. Editing
+			// a .gitignore doesn't change the modification time of its directory, so the index isn't used.
+			const uint64_t settingsHash = hashScanSettings(settings);
+			ScanIndex previousIndex;
+			if(!fullScan && !gitignore && previousIndex.load(indexPath, settingsHash)){
+				settings.previousIndex = &previousIndex;
+			}
+			settings.recordIndex = true;
+			settings.scanStartTime = currentScanTime(settings);
+
+			// Collect file paths and directories
+			if(!scanInputDirectory(settings, workerCount, results)){
+				std::cout << "Unable to read directory " << settings.inputDirPath.string() << std::endl;
+				success = false;
+				continue;
+			}
+			if(results.outOfDescriptors){
+				std::cout << "Too many open files to read directory " << settings.inputDirPath.string() << std::endl;
+				success = false;
+				continue;
+			}
+			if(results.unreadableDirCount != 0){
+				std::cout << "Skipped " << results.unreadableDirCount << " unreadable directories" << std::endl;
+			}
+			// Paths of replayed directories point in the previous index, copy them before it is overwritten.
+			if(watch){
+				for(const IndexDirectoryRecord& record : results.directoryRecords){
+					scannedDirectories.emplace_back(record.path());
+				}
+			}
+			// Only update the index if a directory has been added, removed or listed again, never when checking.
+			const bool indexUnchanged = (settings.previousIndex != nullptr) && (results.reusedDirCount == results.directoryRecords.size()) && (results.reusedDirCount == previousIndex.directoryCount());
+			if(!indexUnchanged && !gitignore && !check && !writeScanIndex(indexPath, settingsHash, results.directoryRecords)){
+				std::cout << "Unable to write index " << indexPath.string() << std::endl;
+			}
+			results.directoryRecords.clear();
+			settings.previousIndex = nullptr;
+		}
+		if(results.prunedDirCount != 0){
+			std::cout << "Pruned " << results.prunedDirCount << " hidden or metadata directories" << std::endl;
+		}
+
+		// Generate projects in parallel, reporting in order.
+		const std::vector<ProjectMask> directoryMasks = collectDirectoryProjects(results);
+		std::vector<std::string> logs(projects.size());
+		std::vector<unsigned char> written(projects.size(), 0);
+		TaskPool pool(std::min<unsigned int>(workerCount, (unsigned int)projects.size()));
+		// Remaining workers help sorting and formatting large projects.
+		const unsigned int projectWorkerCount = std::max(1u, workerCount / (unsigned int)projects.size());
+		for(size_t i = 0; i < projects.size(); ++i){
+			pool.push([&settings, &results, &directoryMasks, &projects, &logs, &written, inPlace, check, projectWorkerCount, i](unsigned int){
+				ProjectItems items;
+				collectProjectItems(settings, results, directoryMasks, i, projectWorkerCount, items);
+				std::ostringstream log;
+				written[i] = check ? checkProjectFiles(projects[i], items, inPlace, log) : writeProjectFiles(projects[i], items, inPlace, projectWorkerCount, log);
+				logs[i] = log.str();
+			}, 0);
+		}
+		pool.run();
+		for(size_t i = 0; i < projects.size(); ++i){
+			std::cout << logs[i] << std::flush;
+			success = success && written[i];
+		}
+		if(!success){
+			continue;
+		}
+
+#ifdef VISUALGEN_WATCH
+		if(watch){
+			ProjectWatcher watcher(projects[0], settings, inPlace, workerCount);
+			if(!watcher.start(results, scannedDirectories)){
+				std::cout << "Unable to watch directory " << settings.inputDirPath.string() << std::endl;
+				return 1;
+			}
+			std::cout << "Watching " << settings.inputDirPath.string() << std::endl;
+			return watcher.run() ? 0 : 1;
+		}
+#endif
+	}
+	if(memoryBudget != 0){
+		std::cout << "Peak memory usage: " << (peakMemoryUsage() >> 20) << " MB" << std::endl;
+	}
+	return success ? 0 : 1;
+
+}
@@ -0,0 +1,80 @@
+#!/bin/bash
+# Golden-output check: generate the project of the fixture tree in each mode and compare
+# the .vcxproj and .vcxproj.filters to the expected ones.
+#	test/golden/check.sh path/to/visualgen [--update]
+# With --update, the expected outputs are replaced by the generated ones instead.
+# Expected outputs use slashes, as written by POSIX builds.
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 path/to/visualgen [--update]"
+	exit 2
+fi
+binary="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+update=0
+if [ "$2" = "--update" ]; then
+	update=1
+fi
+root="$(cd "$(dirname "$0")" && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+excluded="third_party,*.generated.h"
+failures=0
+
+# check name expected [options...]: run visualgen with the options on a fresh copy of the tree.
+# A setup function named setup_<name>, dashes replaced by underscores, can prepare the copy first.
+# Only the check named after its expected outputs updates them, the others are still compared.
+check(){
+	local name="$1"
+	local expected="$root/expected/$2"
+	shift 2
+	local dir="$work/$name"
+	cp -R "$root/tree" "$dir"
+	local setup="setup_${name//-/_}"
+	if declare -F "$setup" > /dev/null; then
+		"$setup" "$dir" || { echo "FAIL $name: setup"; failures=$((failures + 1)); return; }
+	fi
+	if ! (cd "$dir" && "$binary" "$@" golden.vcxproj . "cpp" "h" "$excluded" > "$work/$name.log" 2>&1); then
+		echo "FAIL $name: exit code"
+		cat "$work/$name.log"
+		failures=$((failures + 1))
+		return
+	fi
+	if [ $update -eq 1 ] && [ "$name" = "$(basename "$expected")" ]; then
+		mkdir -p "$expected"
+		cp "$dir/golden.vcxproj" "$dir/golden.vcxproj.filters" "$expected/"
+		echo "UPDATED $name"
+		return
+	fi
+	for file in golden.vcxproj golden.vcxproj.filters; do
+		if ! diff -u "$expected/$file" "$dir/$file"; then
+			echo "FAIL $name: $file"
+			failures=$((failures + 1))
+			return
+		fi
+	done
+	echo "OK $name"
+}
+
+# Existing project with manual edits, backslash paths and a removed file.
+setup_in_place(){
+	cp "$root/in-place.vcxproj" "$1/golden.vcxproj"
+}
+
+# Ignored files aren't added to the index, and untracked files aren't listed.
+setup_git_index(){
+	command -v git > /dev/null || return 1
+	(cd "$1" && git init -q . && git add -A && touch engine/untracked.cpp)
+}
+
+# Streaming and memory budgets produce the same outputs as the default mode.
+check default default
+check stream default --stream
+check memory-budget default --memory-budget=1
+check gitignore gitignore --gitignore
+check in-place in-place --in-place
+check git-index git-index --source=git-index
+
+if [ $failures -ne 0 ]; then
+	echo "$failures failed"
+	exit 1
+fi